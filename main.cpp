@@ -1,802 +1,5965 @@
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <vector>
-#include <sstream>
-#include <cassert>
-#include <algorithm>
-#include <map>
-#include <optional>
-#include <limits>
-#include <charconv>
-#include <limits>
-#include <numeric>
-#include <array>
-#include <format>
-#include <filesystem>
-
-using IST = std::istream_iterator<std::string>;
-
-std::string_view trim_whitespace(std::string_view in)
-{
-	while (!in.empty() && isspace(in.front()))
-	{
-		in.remove_prefix(1);
-	}
-	while (!in.empty() && isspace(in.back()))
-	{
-		in.remove_suffix(1);
-	}
-	return in;
-}
-
-bool cicmp(std::string_view l, std::string_view r)
-{
-	return std::ranges::equal(l, r, {}, ::toupper, ::toupper);
-};
-
-struct Player
-{
-	std::string name;
-	std::map<std::string, int> stats;
-};
-
-std::vector<std::string> read_header(std::istream& is)
-{
-	std::string header_line_data;
-	std::getline(is, header_line_data);
-	std::istringstream header_line{ header_line_data };
-	{
-		std::string name_str;
-		header_line >> name_str;
-		assert(name_str == "Name");
-	}
-
-	std::vector<std::string> result;
-	std::copy(IST{ header_line }, IST{}, std::back_inserter(result));
-	return result;
-}
-
-Player get_player(std::istream& is, const std::vector<std::string>& stats)
-{
-	Player result;
-	is >> std::ws;
-	std::getline(is, result.name);
-	std::string stats_str;
-
-	std::getline(is, stats_str);
-	std::istringstream stats_data{ stats_str };
-	while (!std::isdigit(stats_data.peek()))
-	{
-		if (std::isspace(stats_data.peek()))
-		{
-			stats_data >> std::ws;
-		}
-		else if (std::isalpha(stats_data.peek()))
-		{
-			std::string scratch;
-			stats_data >> scratch;
-		}
-	}
-
-	for (const std::string& stat_name : stats)
-	{
-		assert(!stats_data.eof());
-		int stat = 0;
-		stats_data >> stat;
-		result.stats.insert(std::pair{ stat_name, stat });
-	}
-	std::cout << std::format("    Read in player {}\n", result.name);
-	return result;
-}
-
-std::vector<Player> get_roster(std::istream& input)
-{
-	std::stringstream preprocessed;
-
-	bool first = true;
-
-	// Remove blank lines
-	while (!input.eof())
-	{
-		std::string line;
-		std::getline(input, line);
-		if (!(line.empty() || std::ranges::all_of(line, ::isspace)))
-		{
-			preprocessed << (first ? "" : "\n") << line;
-			first = false;
-		}
-	}
-
-	preprocessed.seekg(0);
-
-	std::vector<Player> result;
-	const std::vector<std::string> header = read_header(preprocessed);
-	while (!preprocessed.eof())
-	{
-		Player new_player = get_player(preprocessed, header);
-		result.push_back(std::move(new_player));
-	}
-	return result;
-}
-
-struct PositionRequirements
-{
-	std::vector<std::string> attacking, defensive;
-	std::map<std::string, std::string> position_to_calculation;
-};
-
-PositionRequirements parse_position_requirements(std::istream& iss)
-{
-	PositionRequirements result;
-	while (!iss.eof())
-	{
-		std::string line_data;
-		std::getline(iss, line_data);
-		std::string_view line = line_data;
-		if (line.empty() || line.front() == '#')
-		{
-			continue;
-		}
-
-		const auto eq_pos = line.find('=');
-		if (eq_pos < line.size())
-		{
-			std::string_view val = trim_whitespace(line.substr(0, eq_pos));
-			std::string_view calculation = trim_whitespace(line.substr(eq_pos + 1));
-			result.position_to_calculation.insert(std::pair{ std::string{val},std::string{calculation} });
-			continue;
-		}
-
-		const auto colon_pos = line.find(':');
-		if (colon_pos < line.size())
-		{
-			constexpr int UNINTIALIZED = 0;
-			constexpr int OFFENCE = 1;
-			constexpr int DEFENCE = 2;
-
-			std::string_view prefix = trim_whitespace(line.substr(0, colon_pos));
-			int status = UNINTIALIZED;
-			switch (prefix.front())
-			{
-			case 'o':
-			case 'O':
-				status = OFFENCE;
-				assert(result.attacking.empty());
-				break;
-			case 'd':
-			case 'D':
-				status = DEFENCE;
-				assert(result.defensive.empty());
-				break;
-			default:
-				break;
-			}
-
-			if (status == UNINTIALIZED) continue;
-
-			std::istringstream positions{ std::string{ line.substr(colon_pos + 1) } };
-			std::vector<std::string>& target = status == OFFENCE ? result.attacking : result.defensive;
-			std::copy(std::istream_iterator<std::string>{positions}, std::istream_iterator<std::string>{}, std::back_inserter(target));
-		}
-	}
-	return result;
-}
-
-double evaluate_player(const Player& player, std::string_view calculation);
-
-double evaluate_player_op(const Player& player, std::string_view calculation, std::size_t op_pos, std::size_t op_len)
-{
-	std::string_view left = calculation.substr(0, op_pos);
-	std::string_view op = calculation.substr(op_pos, op_len);
-	std::string_view right = calculation.substr(op_pos + op_len);
-	const double l = evaluate_player(player, left);
-	const double r = evaluate_player(player, right);
-
-	if (op == "+") return l + r;
-	if (op == "-") return l - r;
-	if (op == "*") return l * r;
-	if (op == "/") return l / r;
-	if (op == "^") return std::pow(l, r);;
-	if (op == ">") return l > r ? 1.0 : 0.0;
-	if (op == "<") return l < r ? 1.0 : 0.0;
-	if (op == ">=") return l >= r ? 1.0 : 0.0;
-	if (op == "<=") return l <= r ? 1.0 : 0.0;
-	if (op == "==") return std::abs(l - r) < 0.000001 ? 1.0 : 0.0;
-	if (op == "!=") return std::abs(l - r) >= 0.000001 ? 1.0 : 0.0;
-
-	const bool bl = std::abs(l) > 0.5;
-	const bool br = std::abs(r) > 0.5;
-
-	if (op == "&&") return bl && br;
-	if (op == "||") return bl || br;
-	assert(false);
-	return 0.0;
-}
-
-double evaluate_player(const Player& player, std::string_view calculation)
-{
-	assert(!calculation.empty());
-	assert(!std::ranges::all_of(calculation, ::isspace));
-	calculation = trim_whitespace(calculation);
-
-	{
-		double result_val = 0.0;
-		std::from_chars_result parse_result = std::from_chars(calculation.data(), calculation.data() + calculation.size(), result_val);
-		if (parse_result.ec == std::errc{} && parse_result.ptr == (calculation.data() + calculation.size()))
-		{
-			return result_val;
-		}
-	}
-
-	bool fully_in_brackets = true;
-	int bracket_depth = 0;
-
-	constexpr std::array<std::string_view, 13> ops = {
-		"||", "&&","<<",">>","<",">","==","!=", "+", "-", "*", "/","^"
-	};
-	std::array<std::optional<std::size_t>, ops.size()> found_ops;
-	bool found_op = false;
-
-	for (std::size_t cal_i = 0; cal_i < calculation.size(); ++cal_i)
-	{
-		const char c = calculation[cal_i];
-		bool done = true;
-		switch (c)
-		{
-		case '(':
-			++bracket_depth;
-			break;
-		case ')':
-			assert(bracket_depth > 0);
-			--bracket_depth;
-			break;
-		default:
-			done = false;
-			break;
-		}
-
-		if (done || (bracket_depth > 0))  continue;
-
-		fully_in_brackets = false;
-		const std::string_view partial_calc = calculation.substr(cal_i);
-		for (std::size_t op_i = 0u;op_i < ops.size();++op_i)
-		{
-			if (partial_calc.size() >= ops[op_i].size() && partial_calc.starts_with(ops[op_i]))
-			{
-				found_ops[op_i] = cal_i;
-				found_op = true;
-				break;
-			}
-		}
-
-	}
-	assert(bracket_depth == 0);
-	if (fully_in_brackets)
-	{
-		calculation.remove_prefix(1);
-		calculation.remove_suffix(1);
-		return evaluate_player(player, calculation);
-	}
-
-	for (std::size_t i = 0u; i < found_ops.size(); ++i)
-	{
-		if (found_ops[i].has_value())
-		{
-			return evaluate_player_op(player, calculation, found_ops[i].value(), ops[i].size());
-		}
-	}
-
-	for (const auto& [stat, val] : player.stats)
-	{
-		if (cicmp(stat, calculation)) return static_cast<double>(val);
-	}
-
-	std::array<std::string_view, 5> functions{
-		"MIN",
-		"MAX",
-		"IF",
-		"POW",
-		"AVERAG£"
-	};
-
-	auto find_result = std::ranges::find_if(functions, [calculation](std::string_view fn)
-		{
-			if (calculation.size() < fn.size()) return false;
-			std::string_view prefix = calculation.substr(0, fn.size());
-			return cicmp(prefix, fn);
-		});
-
-	if (find_result == end(functions))
-	{
-		return 0.0;
-	}
-
-	std::string_view function = *find_result;
-	auto get_args = [](std::string_view args) ->  std::vector<std::string_view>
-		{
-			std::vector<std::string_view> result;
-			const std::size_t bracket_start = args.find_first_of('(');
-			assert(bracket_start < args.size());
-			args = args.substr(bracket_start + 1);
-			const std::size_t bracket_end = args.find_last_of(')');
-			args = args.substr(0, bracket_end);
-
-			bool has_any_nonwhitespace = false;
-			while (!args.empty())
-			{
-				int bracket_depth = 0;
-				std::size_t i = 0u;
-				for (; i < args.size(); ++i)
-				{
-					const char c = args[i];
-					bool found_end = false;
-					if (!isspace(c)) has_any_nonwhitespace = true;
-					switch (c)
-					{
-					case '(':
-						++bracket_depth;
-						break;
-					case ')':
-						assert(bracket_depth > 0);
-						--bracket_depth;
-						break;
-					case ',':
-						if (bracket_depth == 0)
-						{
-							found_end = true;
-						}
-						break;
-					}
-					if (found_end) break;
-				}
-				assert(bracket_depth == 0);
-				result.push_back(args.substr(0, i));
-				args = (i < args.size()) ? args.substr(i + 1) : std::string_view{};
-			}
-			if (!has_any_nonwhitespace) result.clear();
-			return result;
-		};
-
-	const std::vector<std::string_view> fn_args = get_args(calculation.substr(function.size()));
-
-	auto eval = [&player](std::string_view expr) { return evaluate_player(player, expr); };
-	if (function == "MIN")
-	{
-		if (fn_args.empty()) return 0.0f;
-		double result = std::numeric_limits<double>::max();
-		for (std::string_view expr : fn_args)
-		{
-			result = std::min(result, eval(expr));
-		}
-		return result;
-	}
-	if (function == "MAX")
-	{
-		if (fn_args.empty()) return 0.0f;
-		double result = std::numeric_limits<double>::min();
-		for (std::string_view expr : fn_args)
-		{
-			result = std::max(result, eval(expr));
-		}
-		return result;
-	}
-	if (function == "IF")
-	{
-		assert(fn_args.size() == 3u);
-		return eval(std::abs(eval(fn_args[0])) > 0.5 ? fn_args[1] : fn_args[2]);
-	}
-	if (function == "POW")
-	{
-		assert(fn_args.size() == 2u);
-		return std::pow(eval(fn_args[0]), eval(fn_args[1]));
-	}
-	if (function == "AVERAGE")
-	{
-		assert(fn_args.size() > 0);
-		return std::transform_reduce(begin(fn_args), end(fn_args), 0.0, std::plus<double>{}, eval) / static_cast<double>(fn_args.size());
-	}
-	assert(false && "Failed to evaluate");
-	return 0.0f;
-}
-
-double evaluate_player(const Player& player, const std::string& position, const PositionRequirements& requirements)
-{
-	std::string_view calculation = position;
-	auto calc_it = requirements.position_to_calculation.find(position);
-	if (calc_it != end(requirements.position_to_calculation))
-	{
-		calculation = calc_it->second;
-	}
-	return evaluate_player(player, calculation);
-}
-
-struct RosterPosition
-{
-	std::string name, offence, defence;
-	double offensive_score = 0.0;
-	double defensive_score = 0.0;
-	double total_score = 0.0;
-};
-
-struct PickTempData
-{
-	std::string_view name;
-	std::map<std::string_view, double> position_scores;
-	double max_score = 0.0f;
-};
-
-PickTempData to_pick_data(const Player& p, const PositionRequirements& requirements)
-{
-	PickTempData r;
-	r.name = p.name;
-	double max_offence = std::numeric_limits<double>::min();
-	double max_defence = std::numeric_limits<double>::min();
-	auto add_scores = [&r, &requirements, &p](const std::vector<std::string>& positions, double& max)
-		{
-			for (const std::string& pos : positions)
-			{
-				if (!r.position_scores.contains(pos))
-				{
-					const double score = evaluate_player(p, pos, requirements);
-					r.position_scores.insert(std::pair{ std::string_view{ pos }, score });
-					max = std::max(max, score);
-				}
-			}
-		};
-	add_scores(requirements.attacking, max_offence);
-	add_scores(requirements.defensive, max_defence);
-	r.max_score = max_offence + max_defence;
-	std::cout << std::format("    Evaluating {}\n", r.name);
-	return r;
-}
-
-struct PositionDescription
-{
-	std::string_view position;
-	double score = 0.0;
-};
-
-struct StartingPositionDescription
-{
-	std::string_view name;
-	PositionDescription offence, defence;
-	double score = 0.0f;
-};
-
-std::pair<std::vector<std::pair<std::string_view, PositionDescription>>, double> find_best_positions(
-	std::vector<PickTempData>::const_iterator first,
-	std::vector<PickTempData>::const_iterator last,
-	const std::vector<std::string_view>& positions)
-{
-	assert(std::distance(first, last) == positions.size());
-	if (first == last)
-	{
-		return std::make_pair(std::vector<std::pair<std::string_view, PositionDescription>>{}, 0.0);
-	}
-
-	std::vector<std::string_view> checked_positions;
-	checked_positions.reserve(positions.size());
-
-	std::vector<std::pair<std::string_view, PositionDescription>> result;
-	PositionDescription best_position;
-	double best_overall_score = std::numeric_limits<double>::min();
-	const PickTempData& data = *first;
-	for (std::string_view pos : positions)
-	{
-		if (data.position_scores.contains(pos))
-		{
-			if (std::ranges::find(checked_positions, pos) == end(checked_positions))
-			{
-				checked_positions.push_back(pos);
-				const double position_score = data.position_scores.find(pos)->second;
-				auto positions_copy = positions;
-				positions_copy.erase(std::ranges::find(positions_copy, pos));
-				auto [new_result, new_score] = find_best_positions(first + 1, last, positions_copy);
-				const double total = position_score + new_score;
-				if (total > best_overall_score)
-				{
-					result = std::move(new_result);
-					best_position.position = pos;
-					best_position.score = position_score;
-					best_overall_score = total;
-				}
-			}
-		}
-	}
-	result.emplace_back(data.name, std::move(best_position));
-	return std::pair{ std::move(result), best_overall_score };
-}
-
-std::pair<std::vector<std::pair<std::string_view, PositionDescription>>, double> find_best_positions(
-	std::vector<PickTempData>::const_iterator first,
-	std::vector<PickTempData>::const_iterator last,
-	const std::vector<std::string>& positions)
-{
-	std::vector<std::string_view> svpos(begin(positions), end(positions));
-	return find_best_positions(first, last, svpos);
-}
-
-std::pair<std::vector<StartingPositionDescription>, double> get_initial_try_starters(const std::vector<PickTempData>& data, const PositionRequirements& requirements)
-{
-	std::cout << "Picking initial starting line up...\n";
-	const std::size_t target_size = requirements.attacking.size();
-	assert(requirements.defensive.size() == target_size);
-	assert(data.size() >= target_size);
-
-	auto first = begin(data);
-	auto last = first + target_size;
-
-	auto [attacking_lineup, attacking_score] = find_best_positions(first, last, requirements.attacking);
-	auto [defending_lineup, defending_score] = find_best_positions(first, last, requirements.defensive);
-	const double total_score = attacking_score + defending_score;
-
-	std::vector<StartingPositionDescription> result;
-	result.reserve(target_size);
-
-	for (const PickTempData& starter : std::ranges::subrange{ first,last })
-	{
-		auto find_data = [name = starter.name](const std::vector<std::pair<std::string_view, PositionDescription>>& score)
-			{
-				const auto result = std::ranges::find(score, name, [](const std::pair<std::string_view, PositionDescription>& p) {return p.first; });
-				assert(result != end(score));
-				return result->second;
-			};
-
-		StartingPositionDescription r;
-		r.name = starter.name;
-		r.offence = find_data(attacking_lineup);
-		r.defence = find_data(defending_lineup);
-		r.score = r.offence.score + r.defence.score;
-		result.push_back(std::move(r));
-	}
-	return std::pair{ result, total_score };
-}
-
-std::pair<std::vector<StartingPositionDescription>, bool> try_swapping_in_player(std::vector<StartingPositionDescription> picks, const std::vector<PickTempData>& data, const PositionRequirements& requirements, const PickTempData& player)
-{
-	if (std::ranges::find(picks, player.name, [](const StartingPositionDescription& spd) {return spd.name; }) != end(picks))
-	{
-		return std::pair{ picks,false };
-	}
-
-	const double old_defence_score = std::transform_reduce(begin(picks), end(picks), 0.0, std::plus<double>{},
-		[](const StartingPositionDescription& spd) {return spd.defence.score; });
-
-	auto get_pick_data = [&data](std::string_view name) -> const PickTempData&
-		{
-			const auto find_result = std::ranges::find(data, name, [](const PickTempData& ptd) {return ptd.name; });
-			assert(find_result != end(data));
-			return *find_result;
-		};
-
-	std::vector<PickTempData> data_copy;
-	data_copy.reserve(picks.size());
-	std::transform(begin(picks), end(picks), std::back_inserter(data_copy),
-		[&get_pick_data](const StartingPositionDescription& spd) {return get_pick_data(spd.name); });
-
-	std::vector<StartingPositionDescription> best_improvement;
-	std::string_view swapped_out_player;
-	double best_delta = 0.0;
-
-	for (std::size_t i = 0u; i < picks.size(); ++i)
-	{
-		if (player.max_score < picks[i].score) continue;
-		StartingPositionDescription backup_spd = picks[i];
-		PickTempData backup_ptd = data_copy[i];
-
-		data_copy[i] = player;
-		picks[i].name = player.name;
-		picks[i].offence.score = player.position_scores.find(backup_spd.offence.position)->second;
-		const double offence_delta = picks[i].offence.score - backup_spd.offence.score;
-		auto [new_positions, new_score] = find_best_positions(begin(data_copy), end(data_copy), requirements.defensive);
-		const double defence_delta = new_score - old_defence_score;
-		const double change_delta = offence_delta + defence_delta;
-		if (change_delta > best_delta)
-		{
-			best_improvement = picks;
-			best_delta = change_delta;
-			swapped_out_player = backup_spd.name;
-			for (StartingPositionDescription& pick : best_improvement)
-			{
-				auto find_it = std::ranges::find(new_positions, pick.name, [](const auto& d) {return d.first; });
-				assert(find_it != end(new_positions));
-				pick.defence = find_it->second;
-				pick.score = pick.offence.score + pick.defence.score;
-			}
-		}
-
-		data_copy[i] = backup_ptd;
-		picks[i] = backup_spd;
-	}
-
-	if (best_improvement.empty())
-	{
-		return std::pair{ picks, false };
-	}
-
-	for (StartingPositionDescription& spd : best_improvement)
-	{
-		const PickTempData& pdt = get_pick_data(spd.name);
-		spd.defence.score = pdt.position_scores.find(spd.defence.position)->second;
-		spd.score = spd.defence.score + spd.offence.score;
-	}
-	std::cout << std::format("    Swapped in {} replacing {}\n", player.name, swapped_out_player);
-
-	return std::pair{ best_improvement, true };
-}
-
-std::vector<RosterPosition> pick_team(const std::vector<Player>& roster, const PositionRequirements& requirements)
-{
-	std::vector<PickTempData> pick_data;
-	pick_data.reserve(roster.size());
-	std::transform(begin(roster), end(roster), std::back_inserter(pick_data), [&r = requirements](const Player& p) {return to_pick_data(p, r); });
-	std::ranges::sort(pick_data, {}, [](const PickTempData& ptd) {return ptd.max_score; });
-	std::ranges::reverse(pick_data);
-
-	auto [starters, best_score] = get_initial_try_starters(pick_data, requirements);
-
-	bool has_made_change = true;
-	int changes_tried = 0;
-	while (has_made_change)
-	{
-		has_made_change = false;
-		for (const PickTempData& trial_player : pick_data)
-		{
-			std::cout << std::format("{}: trying {} as a starter.\n", changes_tried++, trial_player.name);
-			auto [new_starters, change_made] = try_swapping_in_player(starters, pick_data, requirements, trial_player);
-			if (change_made)
-			{
-				std::cout << "    Swap made. Restarting.\n";
-				const double new_score = std::transform_reduce(begin(new_starters), end(new_starters), 0.0, std::plus<double>{},
-					[](const StartingPositionDescription& spd) {return spd.score; });
-				assert(new_score > best_score);
-				best_score = new_score;
-				starters = std::move(new_starters);
-				has_made_change = true;
-				break;
-			}
-		}
-	}
-	std::vector<RosterPosition> result;
-	result.reserve(starters.size());
-	std::transform(begin(starters), end(starters), std::back_inserter(result),
-		[](const StartingPositionDescription& spd)
-		{
-			RosterPosition r;
-			r.name = std::string{ spd.name };
-			r.offence = std::string{ spd.offence.position };
-			r.defence = std::string{ spd.defence.position };
-			r.offensive_score = spd.offence.score;
-			r.defensive_score = spd.defence.score;
-			r.total_score = spd.score;
-			return r;
-		});
-	return result;
-}
-
-int main(int argc, char** argv)
-{
-	auto quit = []()
-		{
-			std::cout << "Press 'Enter' to quit.";
-			std::cin.get();
-			exit(0);
-		};
-
-	std::cout << "Reading command line args\n";
-	std::filesystem::path team_data{ "team_data.txt" };
-	std::filesystem::path composition{ "composition.txt" };
-	{
-		enum class ArgState
-		{
-			NotFound,
-			Next,
-			Found
-		};
-		ArgState td_state = ArgState::NotFound;
-		ArgState cmp_state = ArgState::NotFound;
-		for (int i = 1; i < argc; ++i)
-		{
-			std::string_view arg{ argv[i] };
-			if (cicmp(arg, "--help") || cicmp(arg, "-help") || cicmp(arg, "help"))
-			{
-				std::cout << "Team Picker by arkadye.\n"
-					"Usage: arguments optional.\n"
-					"    --team-data [path]: a path to a team data file\n"
-					"    --composition [path]: a path to a composition file\n"
-					"For more info and latest versions visit https://github.com/arkadye/team_picker\n";
-				quit();
-			}
-			auto handle_arg = [arg, &quit](std::filesystem::path& target, ArgState& state, std::string_view match)
-				{
-					if (state == ArgState::Next)
-					{
-						target = arg;
-						state = ArgState::Next;
-						return;
-					}
-
-					if (cicmp(arg, match))
-					{
-						if (state == ArgState::Found)
-						{
-							std::cout << "Multiple " << match << " arguments found!\n";
-							quit();
-						}
-						state = ArgState::Next;
-					}
-				};
-
-			handle_arg(team_data, td_state, "--team-data");
-			handle_arg(composition, cmp_state, "--composition");
-		}
-	}
-	std::cout << "Loading " << team_data << '\n';
-	std::ifstream team_input{ team_data };
-	if (!team_input.is_open())
-	{
-		std::cout << "Could not open " << team_data << '\n';
-		quit();
-	}
-	const std::vector<Player> roster = get_roster(team_input);
-
-	std::cout << "Loading " << composition << '\n';
-	std::ifstream req_input{ composition };
-	if (!req_input.is_open())
-	{
-		std::cout << "Could not open " << composition << '\n';
-		quit();
-	}
-	PositionRequirements requirements = parse_position_requirements(req_input);
-
-	std::cout << "Picking the team...\n";
-	std::vector<RosterPosition> picks = pick_team(roster, requirements);
-
-	std::cout << "\nTEAM PICKED:\n";
-
-	std::ranges::sort(picks, std::greater<double>{}, [](const RosterPosition& rp) {return rp.total_score; });
-
-	std::vector<RosterPosition> output;
-	output.reserve(picks.size());
-
-	for (std::string_view pos : requirements.attacking)
-	{
-		auto pick_it = std::ranges::find(picks, pos, [](const RosterPosition& rp) {return rp.offence; });
-		assert(pick_it != end(picks));
-		output.push_back(std::move(*pick_it));
-		picks.erase(pick_it);
-	}
-
-	const std::size_t max_name_len = std::ranges::max(output, {}, [](const RosterPosition& rp) {return rp.name.size(); }).name.size();
-	const std::size_t max_off_len = std::ranges::max(output, {}, [](const RosterPosition& rp) {return rp.offence.size(); }).offence.size();
-	const std::size_t max_def_len = std::ranges::max(output, {}, [](const RosterPosition& rp) {return rp.defence.size(); }).defence.size();
-
-	double team_offensive_score = 0;
-	double team_defensive_score = 0;
-	double team_total_score = 0;
-
-	for (const RosterPosition& pick : output)
-	{
-		std::cout << std::format("{:{}} / {:{}} - {:{}} {:.0f} + {:.0f} = {:.0f}\n",
-			pick.offence, max_off_len,
-			pick.defence, max_def_len,
-			pick.name, max_name_len,
-			pick.offensive_score,
-			pick.defensive_score,
-			pick.total_score
-		);
-
-		team_offensive_score += pick.offensive_score;
-		team_defensive_score += pick.defensive_score;
-		team_total_score += pick.total_score;
-	}
-
-	std::cout << std::format("\n     Team total: {:.0f} + {:.0f} = {:.0f}\n\n",
-		team_offensive_score,
-		team_defensive_score,
-		team_total_score
-	);
-
-	quit();
-}
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cassert>
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <limits>
+#include <charconv>
+#include <limits>
+#include <numeric>
+#include <array>
+#include <format>
+#include <filesystem>
+#include <cstdint>
+#include <cmath>
+#include <span>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <latch>
+#include <atomic>
+#include <memory>
+#include <random>
+#include <cstring>
+#include <bit>
+#include <tuple>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <csignal>
+#endif
+// A scorer written by --generate-scorer, compiled in to score the composition it was generated from.
+#if defined(TEAM_PICKER_SCORER)
+#include TEAM_PICKER_SCORER
+#endif
+
+std::string_view trim_whitespace(std::string_view in)
+{
+	while (!in.empty() && isspace(in.front()))
+	{
+		in.remove_prefix(1);
+	}
+	while (!in.empty() && isspace(in.back()))
+	{
+		in.remove_suffix(1);
+	}
+	return in;
+}
+
+bool cicmp(std::string_view l, std::string_view r)
+{
+	return std::ranges::equal(l, r, {}, ::toupper, ::toupper);
+};
+
+// A fixed set of worker threads, each with its own queue of tasks. Idle workers steal from the front of other
+// queues while owners take from the back. The thread calling parallel_for helps until its tasks are done.
+class ThreadPool
+{
+public:
+	// 0 threads means one per hardware thread. With 1 thread everything runs on the caller.
+	explicit ThreadPool(std::size_t num_threads)
+	{
+		if (num_threads == 0u)
+		{
+			num_threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		m_queues.resize(num_threads);
+		for (std::unique_ptr<Queue>& queue : m_queues)
+		{
+			queue = std::make_unique<Queue>();
+		}
+		for (std::size_t i = 1u; i < num_threads; ++i)
+		{
+			m_workers.emplace_back([this, i](std::stop_token stop) {work(i, stop); });
+		}
+	}
+
+	~ThreadPool()
+	{
+		for (std::jthread& worker : m_workers)
+		{
+			worker.request_stop();
+		}
+		{
+			std::scoped_lock lock{ m_wake_mutex };
+		}
+		m_wake.notify_all();
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	std::size_t size() const { return m_queues.size(); }
+
+	// Calls fn(i) for every i in [0, count), in chunks spread over the workers, and waits for all of them.
+	template <typename Fn>
+	void parallel_for(std::size_t count, Fn&& fn)
+	{
+		parallel_chunks(count, [&fn](std::size_t first, std::size_t last)
+			{
+				for (std::size_t i = first; i < last; ++i) fn(i);
+			});
+	}
+
+	// Calls fn(first, last) for chunks covering [0, count), for callers that set up scratch space once per chunk.
+	template <typename Fn>
+	void parallel_chunks(std::size_t count, Fn&& fn)
+	{
+		if (count == 0u) return;
+		if (m_workers.empty())
+		{
+			fn(std::size_t{ 0u }, count);
+			return;
+		}
+
+		const std::size_t chunk_size = std::max<std::size_t>(1u, count / (size() * 8u));
+		const std::size_t num_chunks = (count + chunk_size - 1u) / chunk_size;
+		std::latch done{ static_cast<std::ptrdiff_t>(num_chunks) };
+		for (std::size_t chunk = 0u; chunk < num_chunks; ++chunk)
+		{
+			const std::size_t first = chunk * chunk_size;
+			const std::size_t last = std::min(count, first + chunk_size);
+			push(chunk % size(), [first, last, &fn, &done]()
+				{
+					fn(first, last);
+					done.count_down();
+				});
+		}
+
+		while (!done.try_wait())
+		{
+			if (std::optional<std::function<void()>> task = pop(0u))
+			{
+				(*task)();
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	std::vector<std::jthread> m_workers;
+	std::mutex m_wake_mutex;
+	std::condition_variable m_wake;
+	std::atomic<std::size_t> m_pending = 0u;
+
+	void push(std::size_t queue_index, std::function<void()> task)
+	{
+		{
+			Queue& queue = *m_queues[queue_index];
+			std::scoped_lock lock{ queue.mutex };
+			queue.tasks.push_back(std::move(task));
+		}
+		{
+			std::scoped_lock lock{ m_wake_mutex };
+			++m_pending;
+		}
+		m_wake.notify_one();
+	}
+
+	std::optional<std::function<void()>> pop(std::size_t own_index)
+	{
+		for (std::size_t offset = 0u; offset < m_queues.size(); ++offset)
+		{
+			Queue& queue = *m_queues[(own_index + offset) % m_queues.size()];
+			std::scoped_lock lock{ queue.mutex };
+			if (queue.tasks.empty()) continue;
+			std::function<void()> task;
+			if (offset == 0u)
+			{
+				task = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+			}
+			else
+			{
+				task = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+			--m_pending;
+			return task;
+		}
+		return std::nullopt;
+	}
+
+	void work(std::size_t index, std::stop_token stop)
+	{
+		while (!stop.stop_requested())
+		{
+			if (std::optional<std::function<void()>> task = pop(index))
+			{
+				(*task)();
+				continue;
+			}
+			std::unique_lock lock{ m_wake_mutex };
+			m_wake.wait(lock, [this, &stop]() {return stop.stop_requested() || m_pending > 0u; });
+		}
+	}
+};
+
+// Calls fn(first, last) for runs of rows_per_task rows covering [0, num_rows), spread over threads threads. With
+// one thread, or only one run, it is called once for all the rows.
+template <typename Fn>
+void parallel_rows(std::size_t num_rows, std::size_t rows_per_task, std::size_t threads, Fn&& fn)
+{
+	const std::size_t num_tasks = (num_rows + rows_per_task - 1u) / rows_per_task;
+	if (threads == 1u || num_tasks <= 1u)
+	{
+		fn(std::size_t{ 0u }, num_rows);
+		return;
+	}
+	ThreadPool pool{ threads };
+	pool.parallel_for(num_tasks, [&](std::size_t task)
+		{
+			const std::size_t first = task * rows_per_task;
+			fn(first, std::min(num_rows, first + rows_per_task));
+		});
+}
+
+// Counters and phase timers for --profile. Everything is gated on one flag, so when profiling is off each
+// counter costs a well-predicted branch.
+enum class ProfileCounter : std::uint8_t
+{
+	FormulaEvaluations,
+	FindBestPositionsCalls,
+	ExhaustiveNodes,
+	SwapRounds,
+	SwapCandidatesSkipped,
+	SwapsTried,
+	SwapsAccepted,
+	AnnealMovesTried,
+	AnnealMovesAccepted,
+	ExactNodes,
+	Count
+};
+
+enum class ProfilePhase : std::uint8_t
+{
+	RosterLoad,
+	CompositionParse,
+	Scoring,
+	Pruning,
+	InitialSeed,
+	SwapSearch,
+	Annealing,
+	ExactSearch,
+	Sensitivity,
+	Count
+};
+
+class Profile
+{
+public:
+	static bool enabled() { return s_enabled; }
+
+	// Turns profiling on and arranges for the report to be written to stderr when the program exits.
+	static void enable()
+	{
+		s_enabled = true;
+		std::atexit([]() {std::cerr << report(); });
+	}
+
+	static void count(ProfileCounter counter, std::uint64_t amount = 1u)
+	{
+		if (s_enabled) s_counters[static_cast<std::size_t>(counter)].fetch_add(amount, std::memory_order_relaxed);
+	}
+
+	static void add_time(ProfilePhase phase, std::chrono::steady_clock::duration time)
+	{
+		const std::size_t index = static_cast<std::size_t>(phase);
+		s_phase_ns[index].fetch_add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count()), std::memory_order_relaxed);
+		s_phase_calls[index].fetch_add(1u, std::memory_order_relaxed);
+	}
+
+	static std::string report()
+	{
+		constexpr std::array<std::string_view, static_cast<std::size_t>(ProfileCounter::Count)> counter_names{
+			"formula_evaluations", "find_best_positions_calls", "exhaustive_nodes", "swap_rounds", "swap_candidates_skipped",
+			"swaps_tried", "swaps_accepted", "anneal_moves_tried", "anneal_moves_accepted", "exact_nodes" };
+		constexpr std::array<std::string_view, static_cast<std::size_t>(ProfilePhase::Count)> phase_names{
+			"roster_load", "composition_parse", "scoring", "pruning", "initial_seed", "swap_search", "annealing", "exact_search", "sensitivity" };
+
+		std::string result = "{\"phases\":{";
+		for (std::size_t i = 0u; i < phase_names.size(); ++i)
+		{
+			result += std::format("{}\"{}\":{{\"ms\":{:.3f},\"calls\":{}}}", i == 0u ? "" : ",", phase_names[i],
+				static_cast<double>(s_phase_ns[i].load()) / 1e6, s_phase_calls[i].load());
+		}
+		result += "},\"counters\":{";
+		for (std::size_t i = 0u; i < counter_names.size(); ++i)
+		{
+			result += std::format("{}\"{}\":{}", i == 0u ? "" : ",", counter_names[i], s_counters[i].load());
+		}
+		result += "}}\n";
+		return result;
+	}
+
+private:
+	static inline bool s_enabled = false;
+	static inline std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(ProfileCounter::Count)> s_counters{};
+	static inline std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(ProfilePhase::Count)> s_phase_ns{};
+	static inline std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(ProfilePhase::Count)> s_phase_calls{};
+};
+
+// Adds the time until it is destroyed to a phase, if profiling is on.
+class PhaseTimer
+{
+public:
+	explicit PhaseTimer(ProfilePhase phase) : m_phase{ phase }
+	{
+		if (Profile::enabled()) m_start = std::chrono::steady_clock::now();
+	}
+	~PhaseTimer()
+	{
+		if (m_start.has_value()) Profile::add_time(m_phase, std::chrono::steady_clock::now() - m_start.value());
+	}
+
+	PhaseTimer(const PhaseTimer&) = delete;
+	PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+	ProfilePhase m_phase;
+	std::optional<std::chrono::steady_clock::time_point> m_start;
+};
+
+// How much progress to print. The team picked and command line errors are always printed.
+enum class LogLevel : std::uint8_t
+{
+	Off,
+	Error,
+	Info,
+	Trace
+};
+
+// Progress messages for the console. A message above the chosen level returns before it is formatted, so trace
+// messages on hot paths cost a branch when --verbose is off. The rest are gathered in a buffer and written a block
+// at a time, by whichever caller fills it or, after start_async, by a background thread. Anything printed straight
+// to std::cout must be preceded by flush() to keep the order.
+class Log
+{
+public:
+	static void set_level(LogLevel level) { s_level.store(level, std::memory_order_relaxed); }
+	static bool enabled(LogLevel level) { return level <= s_level.load(std::memory_order_relaxed); }
+
+	template <typename... Args>
+	static void error(std::format_string<Args...> fmt, Args&&... args)
+	{
+		write(LogLevel::Error, fmt, std::forward<Args>(args)...);
+		flush();
+	}
+
+	template <typename... Args>
+	static void info(std::format_string<Args...> fmt, Args&&... args)
+	{
+		write(LogLevel::Info, fmt, std::forward<Args>(args)...);
+	}
+
+	template <typename... Args>
+	static void trace(std::format_string<Args...> fmt, Args&&... args)
+	{
+		write(LogLevel::Trace, fmt, std::forward<Args>(args)...);
+	}
+
+	// Hands full buffers to a background thread, which writes them out while the caller carries on.
+	static void start_async()
+	{
+		if (s_writer.joinable()) return;
+		s_writer = std::jthread{ [](std::stop_token stop)
+			{
+				std::unique_lock lock{ s_mutex };
+				while (s_wake.wait(lock, stop, []() {return s_buffer.size() >= FLUSH_SIZE; }))
+				{
+					lock.unlock();
+					flush();
+					lock.lock();
+				}
+			} };
+		std::atexit([]()
+			{
+				s_writer.request_stop();
+				s_writer.join();
+				flush();
+			});
+	}
+
+	// Writes out everything logged so far.
+	static void flush()
+	{
+		const std::scoped_lock write_lock{ s_write_mutex };
+		std::string pending;
+		{
+			const std::scoped_lock lock{ s_mutex };
+			pending.swap(s_buffer);
+		}
+		if (pending.empty()) return;
+		std::cout.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+		std::cout.flush();
+	}
+
+private:
+	static constexpr std::size_t FLUSH_SIZE = 64u * 1024u;
+
+	template <typename... Args>
+	static void write(LogLevel level, std::format_string<Args...> fmt, Args&&... args)
+	{
+		if (!enabled(level)) return;
+		bool full = false;
+		{
+			const std::scoped_lock lock{ s_mutex };
+			std::format_to(std::back_inserter(s_buffer), fmt, std::forward<Args>(args)...);
+			full = s_buffer.size() >= FLUSH_SIZE;
+		}
+		if (!full) return;
+		if (s_writer.joinable())
+		{
+			s_wake.notify_one();
+		}
+		else
+		{
+			flush();
+		}
+	}
+
+	static inline std::atomic<LogLevel> s_level{ LogLevel::Info };
+	static inline std::mutex s_mutex;
+	static inline std::mutex s_write_mutex;
+	static inline std::condition_variable_any s_wake;
+	static inline std::string s_buffer;
+	static inline std::jthread s_writer;
+};
+
+// Parses durations such as "500ms", "2s" or "1.5" (seconds).
+std::optional<std::chrono::milliseconds> parse_duration(std::string_view in)
+{
+	double value = 0.0;
+	const std::from_chars_result parse_result = std::from_chars(in.data(), in.data() + in.size(), value);
+	if (parse_result.ec != std::errc{} || value < 0.0) return std::nullopt;
+	const std::string_view unit = in.substr(parse_result.ptr - in.data());
+	double scale = 0.0;
+	if (unit.empty() || cicmp(unit, "s")) scale = 1000.0;
+	else if (cicmp(unit, "ms")) scale = 1.0;
+	else if (cicmp(unit, "m") || cicmp(unit, "min")) scale = 60000.0;
+	else return std::nullopt;
+	return std::chrono::milliseconds{ static_cast<std::int64_t>(value * scale) };
+}
+
+// The whole of a text file, memory-mapped where possible. Falls back to owning a copy of the text.
+class MappedFile
+{
+public:
+	static std::shared_ptr<const MappedFile> open(const std::filesystem::path& path)
+	{
+		std::shared_ptr<MappedFile> result{ new MappedFile };
+#if defined(_WIN32)
+		result->m_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (result->m_file == INVALID_HANDLE_VALUE) return nullptr;
+		LARGE_INTEGER size{};
+		if (!GetFileSizeEx(result->m_file, &size)) return nullptr;
+		result->m_size = static_cast<std::size_t>(size.QuadPart);
+		if (result->m_size == 0u) return result;
+		result->m_mapping = CreateFileMappingW(result->m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (result->m_mapping == nullptr) return nullptr;
+		result->m_data = static_cast<const char*>(MapViewOfFile(result->m_mapping, FILE_MAP_READ, 0, 0, 0));
+		if (result->m_data == nullptr) return nullptr;
+#else
+		result->m_file = ::open(path.c_str(), O_RDONLY);
+		if (result->m_file < 0) return nullptr;
+		struct stat info {};
+		if (fstat(result->m_file, &info) != 0) return nullptr;
+		result->m_size = static_cast<std::size_t>(info.st_size);
+		if (result->m_size == 0u) return result;
+		void* data = mmap(nullptr, result->m_size, PROT_READ, MAP_PRIVATE, result->m_file, 0);
+		if (data == MAP_FAILED) return nullptr;
+		madvise(data, result->m_size, MADV_SEQUENTIAL);
+		result->m_data = static_cast<const char*>(data);
+#endif
+		return result;
+	}
+
+	static std::shared_ptr<const MappedFile> from_string(std::string text)
+	{
+		std::shared_ptr<MappedFile> result{ new MappedFile };
+		result->m_copy = std::move(text);
+		result->m_data = result->m_copy.data();
+		result->m_size = result->m_copy.size();
+		return result;
+	}
+
+	~MappedFile()
+	{
+		const bool is_mapped = m_data != nullptr && m_data != m_copy.data();
+#if defined(_WIN32)
+		if (is_mapped) UnmapViewOfFile(m_data);
+		if (m_mapping != nullptr) CloseHandle(m_mapping);
+		if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+#else
+		if (is_mapped) munmap(const_cast<char*>(m_data), m_size);
+		if (m_file >= 0) ::close(m_file);
+#endif
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	std::string_view contents() const { return std::string_view{ m_data, m_size }; }
+
+private:
+	MappedFile() = default;
+
+	const char* m_data = nullptr;
+	std::size_t m_size = 0u;
+	std::string m_copy;
+#if defined(_WIN32)
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+#else
+	int m_file = -1;
+#endif
+};
+
+// Stats are stored column-major: one column per stat in the header, one row per player.
+// Names are views into source, which the roster keeps alive.
+struct Roster
+{
+	std::shared_ptr<const MappedFile> source;
+	std::vector<std::string> stat_names;
+	std::vector<std::string_view> names;
+	std::vector<std::vector<int>> columns;
+	std::vector<std::string> errors;
+
+	std::size_t size() const { return names.size(); }
+	int stat(std::size_t row, std::size_t stat_index) const { return columns[stat_index][row]; }
+};
+
+// Splits text into lines, skipping blank ones and trimming whitespace (including any '\r'). Line numbers count on
+// from lines_before, for text that starts part way through a file.
+class LineScanner
+{
+public:
+	explicit LineScanner(std::string_view text, std::size_t lines_before = 0u) : m_text{ text }, m_line_number{ lines_before } {}
+
+	std::optional<std::string_view> next()
+	{
+		while (!m_text.empty())
+		{
+			const std::size_t end = std::min(m_text.find('\n'), m_text.size());
+			const std::string_view line = trim_whitespace(m_text.substr(0, end));
+			m_text.remove_prefix(std::min(end + 1, m_text.size()));
+			++m_line_number;
+			if (!line.empty()) return line;
+		}
+		return std::nullopt;
+	}
+
+	std::size_t line_number() const { return m_line_number; }
+	std::string_view remaining() const { return m_text; }
+
+private:
+	std::string_view m_text;
+	std::size_t m_line_number = 0u;
+};
+
+// Takes the next whitespace-separated token off the front of line.
+std::string_view next_token(std::string_view& line)
+{
+	const auto is_space = [](char c) {return std::isspace(static_cast<unsigned char>(c)) != 0; };
+	const auto start = std::ranges::find_if_not(line, is_space);
+	const auto end = std::find_if(start, line.end(), is_space);
+	const std::string_view result{ start, end };
+	line = std::string_view{ end, line.end() };
+	return result;
+}
+
+std::optional<int> parse_int(std::string_view token)
+{
+	int result = 0;
+	const std::from_chars_result parse_result = std::from_chars(token.data(), token.data() + token.size(), result);
+	if (token.empty() || parse_result.ec != std::errc{} || parse_result.ptr != token.data() + token.size()) return std::nullopt;
+	return result;
+}
+
+// Reads the header line, "Name" followed by the stat names.
+bool read_header(LineScanner& lines, Roster& roster)
+{
+	std::optional<std::string_view> header_line = lines.next();
+	if (!header_line.has_value())
+	{
+		roster.errors.push_back("The file is empty");
+		return false;
+	}
+	std::string_view line = header_line.value();
+	if (next_token(line) != "Name")
+	{
+		roster.errors.push_back(std::format("Line {}: the header should start with 'Name'", lines.line_number()));
+		return false;
+	}
+	for (std::string_view stat = next_token(line); !stat.empty(); stat = next_token(line))
+	{
+		roster.stat_names.emplace_back(stat);
+	}
+	roster.columns.resize(roster.stat_names.size());
+	return true;
+}
+
+// Reads a player's name line and their stats line. Metadata before the first number on the stats line is skipped.
+// Malformed records are reported and skipped.
+void get_player(LineScanner& lines, std::string_view name, Roster& roster)
+{
+	const std::size_t name_line_number = lines.line_number();
+	std::optional<std::string_view> stats_line = lines.next();
+	if (!stats_line.has_value())
+	{
+		roster.errors.push_back(std::format("Line {}: {} has no stats line", name_line_number, name));
+		return;
+	}
+
+	// Skip metadata up to the first number.
+	std::string_view line = stats_line.value();
+	std::string_view token = next_token(line);
+	while (!token.empty() && !parse_int(token).has_value())
+	{
+		token = next_token(line);
+	}
+
+	const std::size_t row = roster.size();
+	for (std::size_t i = 0u; i < roster.columns.size(); ++i, token = next_token(line))
+	{
+		const std::optional<int> stat = parse_int(token);
+		if (!stat.has_value())
+		{
+			roster.errors.push_back(token.empty()
+				? std::format("Line {}: {} has {} stats but the header lists {}", lines.line_number(), name, i, roster.columns.size())
+				: std::format("Line {}: {} has '{}' where {} should be", lines.line_number(), name, token, roster.stat_names[i]));
+			for (std::size_t j = 0u; j < i; ++j)
+			{
+				roster.columns[j].resize(row);
+			}
+			return;
+		}
+		roster.columns[i].push_back(stat.value());
+	}
+	roster.names.push_back(name);
+}
+
+// Logged once a roster, or a batch of it, has been read, so players are listed in file order however they were read.
+void trace_players_read(const Roster& roster)
+{
+	if (!Log::enabled(LogLevel::Trace)) return;
+	for (std::string_view name : roster.names)
+	{
+		Log::trace("    Read in player {}\n", name);
+	}
+}
+
+// Below this many bytes a roster is read on one thread.
+constexpr std::size_t MIN_PARSE_CHUNK_BYTES = 64u * 1024u;
+
+// Splits the rest of lines into up to num_chunks scanners, each starting on a player's name line so that it can be
+// read on its own. A player is two non-blank lines, so wherever an odd number of non-blank lines comes before a
+// split it is moved past one more line. The line counts are taken in parallel on pool.
+std::vector<LineScanner> split_players(const LineScanner& lines, std::size_t num_chunks, ThreadPool& pool)
+{
+	const std::string_view text = lines.remaining();
+	num_chunks = std::clamp<std::size_t>(text.size() / MIN_PARSE_CHUNK_BYTES, 1u, num_chunks);
+	std::vector<std::size_t> starts{ 0u };
+	for (std::size_t chunk = 1u; chunk < num_chunks; ++chunk)
+	{
+		const std::size_t line_end = text.find('\n', chunk * text.size() / num_chunks);
+		if (line_end == std::string_view::npos) break;
+		if (line_end + 1u > starts.back()) starts.push_back(line_end + 1u);
+	}
+	starts.push_back(text.size());
+
+	struct LineCount
+	{
+		std::size_t lines = 0u;
+		std::size_t non_blank = 0u;
+	};
+	std::vector<LineCount> counts(starts.size() - 1u);
+	pool.parallel_for(counts.size(), [&](std::size_t i)
+		{
+			LineScanner piece{ text.substr(starts[i], starts[i + 1u] - starts[i]) };
+			while (piece.next().has_value()) ++counts[i].non_blank;
+			counts[i].lines = piece.line_number();
+		});
+
+	std::vector<std::size_t> chunk_starts;
+	std::vector<std::size_t> chunk_lines_before;
+	std::size_t lines_before = lines.line_number();
+	std::size_t non_blank_before = 0u;
+	for (std::size_t i = 0u; i < counts.size(); ++i)
+	{
+		chunk_starts.push_back(starts[i]);
+		chunk_lines_before.push_back(lines_before);
+		if (non_blank_before % 2u != 0u)
+		{
+			// The piece starts with the stats line of the previous piece's last player.
+			LineScanner stats_line{ text.substr(starts[i]), lines_before };
+			stats_line.next();
+			chunk_starts.back() = text.size() - stats_line.remaining().size();
+			chunk_lines_before.back() = stats_line.line_number();
+		}
+		lines_before += counts[i].lines;
+		non_blank_before += counts[i].non_blank;
+	}
+	chunk_starts.push_back(text.size());
+
+	std::vector<LineScanner> result;
+	for (std::size_t i = 0u; i < chunk_lines_before.size(); ++i)
+	{
+		result.emplace_back(text.substr(chunk_starts[i], chunk_starts[i + 1u] - chunk_starts[i]), chunk_lines_before[i]);
+	}
+	return result;
+}
+
+// Reads the players on up to threads threads, each taking a run of whole records. The pieces are joined in file
+// order, so names, stats and errors (with their line numbers) are the same as when read on one thread.
+Roster parse_roster(std::shared_ptr<const MappedFile> source, std::size_t threads = 1u)
+{
+	Roster result;
+	result.source = std::move(source);
+	LineScanner lines{ result.source->contents() };
+	if (!read_header(lines, result)) return result;
+
+	std::optional<ThreadPool> pool;
+	if (threads != 1u && lines.remaining().size() >= 2u * MIN_PARSE_CHUNK_BYTES) pool.emplace(threads);
+	const std::vector<LineScanner> chunks = pool.has_value() ? split_players(lines, pool->size(), pool.value()) : std::vector<LineScanner>{};
+	if (chunks.size() <= 1u)
+	{
+		while (std::optional<std::string_view> name = lines.next())
+		{
+			get_player(lines, name.value(), result);
+		}
+		trace_players_read(result);
+		return result;
+	}
+
+	std::vector<Roster> pieces(chunks.size());
+	pool->parallel_for(chunks.size(), [&](std::size_t i)
+		{
+			Roster& piece = pieces[i];
+			piece.stat_names = result.stat_names;
+			piece.columns.resize(result.columns.size());
+			LineScanner chunk = chunks[i];
+			while (std::optional<std::string_view> name = chunk.next())
+			{
+				get_player(chunk, name.value(), piece);
+			}
+		});
+	for (Roster& piece : pieces)
+	{
+		result.names.insert(end(result.names), begin(piece.names), end(piece.names));
+		for (std::size_t stat = 0u; stat < result.columns.size(); ++stat)
+		{
+			result.columns[stat].insert(end(result.columns[stat]), begin(piece.columns[stat]), end(piece.columns[stat]));
+		}
+		std::ranges::move(piece.errors, std::back_inserter(result.errors));
+	}
+	trace_players_read(result);
+	return result;
+}
+
+// Returns an empty optional if the file cannot be opened.
+std::optional<Roster> load_roster(const std::filesystem::path& path, std::size_t threads = 1u)
+{
+	const PhaseTimer timer{ ProfilePhase::RosterLoad };
+	std::shared_ptr<const MappedFile> source = MappedFile::open(path);
+	if (source == nullptr) return std::nullopt;
+	return parse_roster(std::move(source), threads);
+}
+
+
+Roster get_roster(std::istream& input)
+{
+	std::string text{ std::istreambuf_iterator<char>{ input }, std::istreambuf_iterator<char>{} };
+	return parse_roster(MappedFile::from_string(std::move(text)));
+}
+
+// A roster file opened for streaming: the header has been read and lines is left at the first player.
+struct RosterStream
+{
+	Roster batch;
+	LineScanner lines{ std::string_view{} };
+};
+
+// Returns an empty optional if the file cannot be opened. Header errors are left in batch.errors.
+std::optional<RosterStream> open_roster_stream(const std::filesystem::path& path)
+{
+	std::shared_ptr<const MappedFile> source = MappedFile::open(path);
+	if (source == nullptr) return std::nullopt;
+	RosterStream result{ Roster{}, LineScanner{ source->contents() } };
+	result.batch.source = std::move(source);
+	read_header(result.lines, result.batch);
+	return result;
+}
+
+enum class OpCode : std::uint8_t
+{
+	Constant,
+	Stat,
+	Negate,
+	Add,
+	Subtract,
+	Multiply,
+	Divide,
+	Power,
+	Less,
+	Greater,
+	LessEqual,
+	GreaterEqual,
+	Equal,
+	NotEqual,
+	And,
+	Or,
+	Not,
+	Min,
+	Max,
+	Average,
+	If
+};
+
+struct Instruction
+{
+	OpCode op = OpCode::Constant;
+	std::uint32_t arg = 0; // Stat slot for Stat, argument count for Min/Max/Average.
+	double value = 0.0;
+};
+
+// A formula compiled to postfix bytecode. Stats are referred to by their column in the Roster.
+struct Formula
+{
+	std::vector<Instruction> code;
+	std::size_t stack_size = 0;
+};
+
+constexpr std::size_t MAX_FORMULA_STACK = 256;
+
+bool as_bool(double val)
+{
+	return std::abs(val) >= 0.5;
+}
+
+double from_bool(bool val)
+{
+	return val ? 1.0 : 0.0;
+}
+
+double apply_binary(OpCode op, double l, double r)
+{
+	switch (op)
+	{
+	case OpCode::Add: return l + r;
+	case OpCode::Subtract: return l - r;
+	case OpCode::Multiply: return l * r;
+	case OpCode::Divide: return l / r;
+	case OpCode::Power: return std::pow(l, r);
+	case OpCode::Less: return from_bool(l < r);
+	case OpCode::Greater: return from_bool(l > r);
+	case OpCode::LessEqual: return from_bool(l <= r);
+	case OpCode::GreaterEqual: return from_bool(l >= r);
+	case OpCode::Equal: return from_bool(std::abs(l - r) < 0.000001);
+	case OpCode::NotEqual: return from_bool(std::abs(l - r) >= 0.000001);
+	case OpCode::And: return from_bool(as_bool(l) && as_bool(r));
+	case OpCode::Or: return from_bool(as_bool(l) || as_bool(r));
+	default:
+		assert(false && "Unhandled opcode");
+		return 0.0;
+	}
+}
+
+double evaluate_formula(const Formula& formula, const Roster& roster, std::size_t row)
+{
+	Profile::count(ProfileCounter::FormulaEvaluations);
+	std::array<double, MAX_FORMULA_STACK> stack;
+	std::size_t top = 0;
+	for (const Instruction& ins : formula.code)
+	{
+		switch (ins.op)
+		{
+		case OpCode::Constant:
+			stack[top++] = ins.value;
+			continue;
+		case OpCode::Stat:
+			stack[top++] = static_cast<double>(roster.stat(row, ins.arg));
+			continue;
+		case OpCode::Negate:
+			stack[top - 1] = -stack[top - 1];
+			continue;
+		case OpCode::Not:
+			stack[top - 1] = from_bool(!as_bool(stack[top - 1]));
+			continue;
+		case OpCode::Min:
+		case OpCode::Max:
+		case OpCode::Average:
+		{
+			const double* first = stack.data() + top - ins.arg;
+			const double* last = stack.data() + top;
+			double result = 0.0;
+			if (ins.op == OpCode::Min) result = *std::min_element(first, last);
+			else if (ins.op == OpCode::Max) result = *std::max_element(first, last);
+			else result = std::accumulate(first, last, 0.0) / static_cast<double>(ins.arg);
+			top -= ins.arg;
+			stack[top++] = result;
+			continue;
+		}
+		case OpCode::If:
+		{
+			top -= 2;
+			stack[top - 1] = as_bool(stack[top - 1]) ? stack[top] : stack[top + 1];
+			continue;
+		}
+		default:
+			break;
+		}
+
+		const double r = stack[--top];
+		double& l = stack[top - 1];
+		l = apply_binary(ins.op, l, r);
+	}
+	assert(top == 1);
+	return stack[0];
+}
+
+// Batch evaluation: runs a formula over a block of rows at a time, with one stack slot per row for each stack
+// entry. Each instruction is then a straight loop over the block, vectorised with AVX2 where available.
+constexpr std::size_t FORMULA_BATCH_ROWS = 256;
+
+// Rows scored per task when scoring on several threads. A whole number of batches, so every block of rows is the
+// same as when scored on one thread.
+constexpr std::size_t PARALLEL_SCORE_ROWS = 16u * FORMULA_BATCH_ROWS;
+
+#if defined(__AVX2__)
+template <typename VecOp>
+void batch_binary_avx2(double* l, const double* r, std::size_t& i, std::size_t n, VecOp vec_op)
+{
+	for (; i + 4u <= n; i += 4u)
+	{
+		_mm256_storeu_pd(l + i, vec_op(_mm256_loadu_pd(l + i), _mm256_loadu_pd(r + i)));
+	}
+}
+#endif
+
+// l[i] = l[i] op r[i] for i in [0, n).
+void batch_binary(OpCode op, double* l, const double* r, std::size_t n)
+{
+	std::size_t i = 0u;
+#if defined(__AVX2__)
+	const __m256d one = _mm256_set1_pd(1.0);
+	const __m256d half = _mm256_set1_pd(0.5);
+	const __m256d epsilon = _mm256_set1_pd(0.000001);
+	const __m256d sign = _mm256_set1_pd(-0.0);
+	auto truth = [one](__m256d mask) {return _mm256_and_pd(mask, one); };
+	auto is_true = [half, sign](__m256d v) {return _mm256_cmp_pd(_mm256_andnot_pd(sign, v), half, _CMP_GE_OQ); };
+	switch (op)
+	{
+	case OpCode::Add: batch_binary_avx2(l, r, i, n, [](__m256d a, __m256d b) {return _mm256_add_pd(a, b); }); break;
+	case OpCode::Subtract: batch_binary_avx2(l, r, i, n, [](__m256d a, __m256d b) {return _mm256_sub_pd(a, b); }); break;
+	case OpCode::Multiply: batch_binary_avx2(l, r, i, n, [](__m256d a, __m256d b) {return _mm256_mul_pd(a, b); }); break;
+	case OpCode::Divide: batch_binary_avx2(l, r, i, n, [](__m256d a, __m256d b) {return _mm256_div_pd(a, b); }); break;
+	case OpCode::Less: batch_binary_avx2(l, r, i, n, [&](__m256d a, __m256d b) {return truth(_mm256_cmp_pd(a, b, _CMP_LT_OQ)); }); break;
+	case OpCode::Greater: batch_binary_avx2(l, r, i, n, [&](__m256d a, __m256d b) {return truth(_mm256_cmp_pd(a, b, _CMP_GT_OQ)); }); break;
+	case OpCode::LessEqual: batch_binary_avx2(l, r, i, n, [&](__m256d a, __m256d b) {return truth(_mm256_cmp_pd(a, b, _CMP_LE_OQ)); }); break;
+	case OpCode::GreaterEqual: batch_binary_avx2(l, r, i, n, [&](__m256d a, __m256d b) {return truth(_mm256_cmp_pd(a, b, _CMP_GE_OQ)); }); break;
+	case OpCode::Equal:
+		batch_binary_avx2(l, r, i, n, [&](__m256d a, __m256d b) {return truth(_mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(a, b)), epsilon, _CMP_LT_OQ)); });
+		break;
+	case OpCode::NotEqual:
+		batch_binary_avx2(l, r, i, n, [&](__m256d a, __m256d b) {return truth(_mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(a, b)), epsilon, _CMP_GE_OQ)); });
+		break;
+	case OpCode::And: batch_binary_avx2(l, r, i, n, [&](__m256d a, __m256d b) {return truth(_mm256_and_pd(is_true(a), is_true(b))); }); break;
+	case OpCode::Or: batch_binary_avx2(l, r, i, n, [&](__m256d a, __m256d b) {return truth(_mm256_or_pd(is_true(a), is_true(b))); }); break;
+	default:
+		break; // No vector pow, so that falls through to the scalar loop.
+	}
+#endif
+	for (; i < n; ++i)
+	{
+		l[i] = apply_binary(op, l[i], r[i]);
+	}
+}
+
+// The formulas of a composition merged into one graph, so that a subexpression used by several positions, or several
+// times in one, is evaluated once per player. Nodes are only ever added after their inputs, so their order is an
+// evaluation order. Identical nodes are shared, and a node whose inputs are all constants is folded into a
+// constant as it is added.
+struct FormulaNode
+{
+	OpCode op = OpCode::Constant;
+	std::uint32_t arg = 0; // As in Instruction.
+	double value = 0.0;
+	std::vector<std::uint32_t> inputs;
+};
+
+// Evaluates one node for n rows starting at first_row, given the blocks holding its inputs' values for those rows.
+void evaluate_node(const FormulaNode& node, std::span<const double* const> inputs, const Roster* roster, std::size_t first_row, std::size_t n, double* target)
+{
+	switch (node.op)
+	{
+	case OpCode::Constant:
+		std::fill_n(target, n, node.value);
+		return;
+	case OpCode::Stat:
+	{
+		const int* column = roster->columns[node.arg].data() + first_row;
+		std::size_t i = 0u;
+#if defined(__AVX2__)
+		for (; i + 4u <= n; i += 4u)
+		{
+			_mm256_storeu_pd(target + i, _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i*>(column + i))));
+		}
+#endif
+		for (; i < n; ++i) target[i] = static_cast<double>(column[i]);
+		return;
+	}
+	case OpCode::Negate:
+		for (std::size_t i = 0u; i < n; ++i) target[i] = -inputs[0][i];
+		return;
+	case OpCode::Not:
+		for (std::size_t i = 0u; i < n; ++i) target[i] = from_bool(!as_bool(inputs[0][i]));
+		return;
+	case OpCode::Min:
+	case OpCode::Max:
+	case OpCode::Average:
+	{
+		std::copy_n(inputs[0], n, target);
+		for (const double* source : inputs.subspan(1))
+		{
+			if (node.op == OpCode::Min) for (std::size_t i = 0u; i < n; ++i) target[i] = std::min(target[i], source[i]);
+			else if (node.op == OpCode::Max) for (std::size_t i = 0u; i < n; ++i) target[i] = std::max(target[i], source[i]);
+			else for (std::size_t i = 0u; i < n; ++i) target[i] += source[i];
+		}
+		if (node.op == OpCode::Average)
+		{
+			const double count = static_cast<double>(inputs.size());
+			for (std::size_t i = 0u; i < n; ++i) target[i] /= count;
+		}
+		return;
+	}
+	case OpCode::If:
+		// Both branches have already been evaluated, so this is a select rather than a branch.
+		for (std::size_t i = 0u; i < n; ++i) target[i] = as_bool(inputs[0][i]) ? inputs[1][i] : inputs[2][i];
+		return;
+	default:
+		std::copy_n(inputs[0], n, target);
+		batch_binary(node.op, target, inputs[1], n);
+		return;
+	}
+}
+
+class FormulaGraph
+{
+public:
+	// Adds a formula's nodes to the graph, returning the one holding its result.
+	std::uint32_t add(const Formula& formula)
+	{
+		std::vector<std::uint32_t> stack;
+		for (const Instruction& ins : formula.code)
+		{
+			std::size_t num_inputs = 2u;
+			switch (ins.op)
+			{
+			case OpCode::Constant:
+			case OpCode::Stat:
+				num_inputs = 0u;
+				break;
+			case OpCode::Negate:
+			case OpCode::Not:
+				num_inputs = 1u;
+				break;
+			case OpCode::Min:
+			case OpCode::Max:
+			case OpCode::Average:
+				num_inputs = ins.arg;
+				break;
+			case OpCode::If:
+				num_inputs = 3u;
+				break;
+			default:
+				break;
+			}
+			assert(stack.size() >= num_inputs);
+			std::vector<std::uint32_t> inputs(end(stack) - num_inputs, end(stack));
+			stack.resize(stack.size() - num_inputs);
+			stack.push_back(add_node(FormulaNode{ ins.op, ins.arg, ins.value, std::move(inputs) }));
+		}
+		assert(stack.size() == 1u);
+		return stack.front();
+	}
+
+	std::size_t size() const { return m_nodes.size(); }
+	const std::vector<FormulaNode>& nodes() const { return m_nodes; }
+
+	// Evaluates the output nodes for num_rows rows starting at first_row, returning one column per output. Only the
+	// nodes the outputs depend on are evaluated, a block of rows at a time. A node's block is reused once the last
+	// node reading it is done, so the working set stays small however many nodes there are.
+	std::vector<std::vector<double>> evaluate(const Roster& roster, std::span<const std::uint32_t> outputs, std::size_t first_row, std::size_t num_rows) const
+	{
+		Profile::count(ProfileCounter::FormulaEvaluations, outputs.size() * num_rows);
+		constexpr std::uint32_t KEEP = std::numeric_limits<std::uint32_t>::max();
+		std::vector<bool> needed(m_nodes.size(), false);
+		std::vector<std::uint32_t> last_use(m_nodes.size(), 0u);
+		for (std::uint32_t output : outputs)
+		{
+			needed[output] = true;
+			last_use[output] = KEEP;
+		}
+		for (std::size_t id = m_nodes.size(); id-- > 0u;)
+		{
+			if (!needed[id]) continue;
+			for (std::uint32_t input : m_nodes[id].inputs)
+			{
+				needed[input] = true;
+				last_use[input] = std::max(last_use[input], static_cast<std::uint32_t>(id));
+			}
+		}
+
+		// The block for each node, taken before its inputs' blocks are given back so it never overlaps them.
+		std::vector<std::size_t> block_of(m_nodes.size());
+		std::vector<std::size_t> free_blocks;
+		std::size_t num_blocks = 0u;
+		for (std::size_t id = 0u; id < m_nodes.size(); ++id)
+		{
+			if (!needed[id]) continue;
+			if (free_blocks.empty())
+			{
+				block_of[id] = num_blocks++;
+			}
+			else
+			{
+				block_of[id] = free_blocks.back();
+				free_blocks.pop_back();
+			}
+			for (std::uint32_t input : m_nodes[id].inputs)
+			{
+				if (last_use[input] != id) continue;
+				free_blocks.push_back(block_of[input]);
+				last_use[input] = 0u;
+			}
+		}
+
+		const std::size_t block_rows = std::clamp<std::size_t>(num_rows, 1u, FORMULA_BATCH_ROWS);
+		std::vector<double> blocks(num_blocks * block_rows);
+		auto block = [&blocks, block_rows](std::size_t index) {return blocks.data() + index * block_rows; };
+		std::vector<std::vector<double>> result(outputs.size(), std::vector<double>(num_rows));
+		std::vector<const double*> inputs;
+		for (std::size_t done = 0u; done < num_rows; done += block_rows)
+		{
+			const std::size_t n = std::min(block_rows, num_rows - done);
+			for (std::size_t id = 0u; id < m_nodes.size(); ++id)
+			{
+				if (!needed[id]) continue;
+				inputs.clear();
+				for (std::uint32_t input : m_nodes[id].inputs) inputs.push_back(block(block_of[input]));
+				evaluate_node(m_nodes[id], inputs, &roster, first_row + done, n, block(block_of[id]));
+			}
+			for (std::size_t i = 0u; i < outputs.size(); ++i)
+			{
+				std::copy_n(block(block_of[outputs[i]]), n, result[i].data() + done);
+			}
+		}
+		return result;
+	}
+
+private:
+	using NodeKey = std::tuple<OpCode, std::uint32_t, std::uint64_t, std::vector<std::uint32_t>>;
+	std::vector<FormulaNode> m_nodes;
+	std::map<NodeKey, std::uint32_t> m_index;
+
+	bool is_constant(std::uint32_t id) const { return m_nodes[id].op == OpCode::Constant; }
+
+	std::uint32_t add_node(FormulaNode node)
+	{
+		if (!node.inputs.empty() && std::ranges::all_of(node.inputs, [this](std::uint32_t id) {return is_constant(id); }))
+		{
+			// Folded by the same code that evaluates it per player, so the result is exactly the same.
+			std::vector<const double*> inputs;
+			for (std::uint32_t id : node.inputs) inputs.push_back(&m_nodes[id].value);
+			double value = 0.0;
+			evaluate_node(node, inputs, nullptr, 0u, 1u, &value);
+			node = FormulaNode{ OpCode::Constant, 0, value, {} };
+		}
+		else if (node.op == OpCode::If && is_constant(node.inputs[0]))
+		{
+			return as_bool(m_nodes[node.inputs[0]].value) ? node.inputs[1] : node.inputs[2];
+		}
+		else if ((node.op == OpCode::Add || node.op == OpCode::Multiply) && node.inputs[0] > node.inputs[1])
+		{
+			// Exact in floating point, so a + b and b + a can share a node.
+			std::swap(node.inputs[0], node.inputs[1]);
+		}
+
+		NodeKey key{ node.op, node.arg, std::bit_cast<std::uint64_t>(node.value), node.inputs };
+		const auto [it, inserted] = m_index.try_emplace(std::move(key), static_cast<std::uint32_t>(m_nodes.size()));
+		if (inserted) m_nodes.push_back(std::move(node));
+		return it->second;
+	}
+};
+
+
+class FormulaCompiler
+{
+public:
+	FormulaCompiler(const std::vector<std::string>& stat_names) : m_stat_names{ stat_names } {}
+
+	// Returns an empty optional and fills in error on failure.
+	std::optional<Formula> compile(std::string_view calculation, std::string& error)
+	{
+		m_formula = Formula{};
+		m_depth = 0;
+		m_error.clear();
+		if (!compile_expression(calculation))
+		{
+			error = std::format("{} in '{}'", m_error, calculation);
+			return std::nullopt;
+		}
+		assert(m_depth == 1);
+		return std::move(m_formula);
+	}
+
+private:
+	const std::vector<std::string>& m_stat_names;
+	Formula m_formula;
+	std::size_t m_depth = 0;
+	std::string m_error;
+
+	bool fail(std::string message)
+	{
+		m_error = std::move(message);
+		return false;
+	}
+
+	bool emit(OpCode op, std::uint32_t arg = 0, double value = 0.0)
+	{
+		switch (op)
+		{
+		case OpCode::Constant:
+		case OpCode::Stat:
+			++m_depth;
+			break;
+		case OpCode::Negate:
+		case OpCode::Not:
+			break;
+		case OpCode::Min:
+		case OpCode::Max:
+		case OpCode::Average:
+			m_depth -= arg - 1;
+			break;
+		case OpCode::If:
+			m_depth -= 2;
+			break;
+		default:
+			--m_depth;
+			break;
+		}
+		m_formula.stack_size = std::max(m_formula.stack_size, m_depth);
+		if (m_formula.stack_size > MAX_FORMULA_STACK)
+		{
+			return fail("Formula is too complex");
+		}
+		m_formula.code.push_back(Instruction{ op, arg, value });
+		return true;
+	}
+
+	static bool is_identifier_char(char c)
+	{
+		return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+	}
+
+	// A '+' or '-' with no operand to its left is a sign, not a binary operator.
+	// Neither is one inside a number such as "1e-5".
+	static bool is_sign(std::string_view calculation, std::size_t pos)
+	{
+		const std::string_view before = trim_whitespace(calculation.substr(0, pos));
+		if (before.empty()) return true;
+		if (std::string_view{ "+-*/^<>=!&|(," }.find(before.back()) < std::string_view::npos) return true;
+		if (before.size() >= 2 && (before.back() == 'e' || before.back() == 'E') && std::isdigit(static_cast<unsigned char>(before[before.size() - 2])))
+		{
+			const auto word_start = std::find_if_not(before.rbegin(), before.rend(), is_identifier_char);
+			return std::isdigit(static_cast<unsigned char>(*(word_start.base())));
+		}
+		return false;
+	}
+
+	bool compile_expression(std::string_view calculation)
+	{
+		calculation = trim_whitespace(calculation);
+		if (calculation.empty())
+		{
+			return fail("Missing expression");
+		}
+
+		{
+			double result_val = 0.0;
+			std::from_chars_result parse_result = std::from_chars(calculation.data(), calculation.data() + calculation.size(), result_val);
+			if (parse_result.ec == std::errc{} && parse_result.ptr == (calculation.data() + calculation.size()))
+			{
+				return emit(OpCode::Constant, 0, result_val);
+			}
+		}
+
+		// Operators in increasing order of precedence. Each is split at its last occurrence so they associate left-to-right.
+		struct Operator
+		{
+			std::string_view token;
+			OpCode op;
+		};
+		constexpr std::array<Operator, 13> ops = { {
+			{ "||", OpCode::Or },
+			{ "&&", OpCode::And },
+			{ "<=", OpCode::LessEqual },
+			{ ">=", OpCode::GreaterEqual },
+			{ "<", OpCode::Less },
+			{ ">", OpCode::Greater },
+			{ "==", OpCode::Equal },
+			{ "!=", OpCode::NotEqual },
+			{ "+", OpCode::Add },
+			{ "-", OpCode::Subtract },
+			{ "*", OpCode::Multiply },
+			{ "/", OpCode::Divide },
+			{ "^", OpCode::Power }
+		} };
+		std::array<std::optional<std::size_t>, ops.size()> found_ops;
+
+		int bracket_depth = 0;
+		std::optional<std::size_t> outer_bracket_close;
+		for (std::size_t cal_i = 0; cal_i < calculation.size(); ++cal_i)
+		{
+			const char c = calculation[cal_i];
+			if (c == '(')
+			{
+				++bracket_depth;
+				continue;
+			}
+			if (c == ')')
+			{
+				if (bracket_depth == 0) return fail("Unmatched ')'");
+				--bracket_depth;
+				if (bracket_depth == 0 && !outer_bracket_close.has_value()) outer_bracket_close = cal_i;
+				continue;
+			}
+			if (bracket_depth > 0) continue;
+
+			const std::string_view partial_calc = calculation.substr(cal_i);
+			for (std::size_t op_i = 0u; op_i < ops.size(); ++op_i)
+			{
+				if (partial_calc.starts_with(ops[op_i].token))
+				{
+					const bool is_unary = (ops[op_i].op == OpCode::Add || ops[op_i].op == OpCode::Subtract) && is_sign(calculation, cal_i);
+					if (!is_unary)
+					{
+						found_ops[op_i] = cal_i;
+						cal_i += ops[op_i].token.size() - 1;
+					}
+					break;
+				}
+			}
+		}
+		if (bracket_depth != 0)
+		{
+			return fail("Unmatched '('");
+		}
+
+		for (std::size_t i = 0u; i < found_ops.size(); ++i)
+		{
+			if (found_ops[i].has_value())
+			{
+				const std::size_t op_pos = found_ops[i].value();
+				return compile_expression(calculation.substr(0, op_pos))
+					&& compile_expression(calculation.substr(op_pos + ops[i].token.size()))
+					&& emit(ops[i].op);
+			}
+		}
+
+		if (calculation.front() == '(' && outer_bracket_close == calculation.size() - 1)
+		{
+			calculation.remove_prefix(1);
+			calculation.remove_suffix(1);
+			return compile_expression(calculation);
+		}
+
+		if (calculation.front() == '-')
+		{
+			return compile_expression(calculation.substr(1)) && emit(OpCode::Negate);
+		}
+		if (calculation.front() == '+')
+		{
+			return compile_expression(calculation.substr(1));
+		}
+
+		const auto name_end = std::ranges::find_if_not(calculation, is_identifier_char);
+		const std::string_view name{ begin(calculation), name_end };
+		if (name.empty())
+		{
+			return fail(std::format("Unexpected '{}'", calculation.front()));
+		}
+
+		if (name.size() == calculation.size())
+		{
+			const auto stat_it = std::ranges::find_if(m_stat_names, [name](const std::string& stat) {return cicmp(stat, name); });
+			if (stat_it == end(m_stat_names))
+			{
+				return fail(std::format("Unknown stat '{}'", name));
+			}
+			return emit(OpCode::Stat, static_cast<std::uint32_t>(std::distance(begin(m_stat_names), stat_it)));
+		}
+
+		std::string_view args = trim_whitespace(calculation.substr(name.size()));
+		if (args.front() != '(' || args.back() != ')')
+		{
+			return fail(std::format("Expected '(' after '{}'", name));
+		}
+		args.remove_prefix(1);
+		args.remove_suffix(1);
+
+		std::vector<std::string_view> fn_args;
+		if (!trim_whitespace(args).empty())
+		{
+			int depth = 0;
+			std::size_t arg_start = 0u;
+			for (std::size_t i = 0u; i <= args.size(); ++i)
+			{
+				const char c = i < args.size() ? args[i] : ',';
+				if (c == '(') ++depth;
+				else if (c == ')') --depth;
+				else if (c == ',' && depth == 0)
+				{
+					fn_args.push_back(args.substr(arg_start, i - arg_start));
+					arg_start = i + 1;
+				}
+			}
+		}
+
+		struct Function
+		{
+			std::string_view name;
+			OpCode op;
+			std::size_t min_args, max_args;
+		};
+		constexpr std::size_t ANY = std::numeric_limits<std::size_t>::max();
+		constexpr std::array<Function, 6> functions = { {
+			{ "MIN", OpCode::Min, 0, ANY },
+			{ "MAX", OpCode::Max, 0, ANY },
+			{ "AVERAGE", OpCode::Average, 1, ANY },
+			{ "IF", OpCode::If, 3, 3 },
+			{ "POW", OpCode::Power, 2, 2 },
+			{ "NOT", OpCode::Not, 1, 1 }
+		} };
+
+		const auto fn_it = std::ranges::find_if(functions, [name](const Function& fn) {return cicmp(fn.name, name); });
+		if (fn_it == end(functions))
+		{
+			return fail(std::format("Unknown function '{}'", name));
+		}
+		if (fn_args.size() < fn_it->min_args || fn_args.size() > fn_it->max_args)
+		{
+			return fail(std::format("Wrong number of arguments to '{}'", name));
+		}
+		if (fn_args.empty())
+		{
+			return emit(OpCode::Constant, 0, 0.0);
+		}
+		for (std::string_view arg : fn_args)
+		{
+			if (!compile_expression(arg)) return false;
+		}
+		return emit(fn_it->op, static_cast<std::uint32_t>(fn_args.size()));
+	}
+};
+
+std::uint64_t hash_bytes(std::string_view bytes, std::uint64_t hash = 0xcbf29ce484222325ull)
+{
+	for (char c : bytes)
+	{
+		hash ^= static_cast<unsigned char>(c);
+		hash *= 0x100000001b3ull;
+	}
+	return hash;
+}
+
+template <typename T>
+std::string_view object_bytes(const T& value)
+{
+	return std::string_view{ reinterpret_cast<const char*>(&value), sizeof(T) };
+}
+
+// Hashes the compiled code rather than the text, so calculations that differ only in spacing or case match.
+std::uint64_t hash_formula(const Formula& formula)
+{
+	std::uint64_t hash = hash_bytes({});
+	for (const Instruction& ins : formula.code)
+	{
+		hash = hash_bytes(object_bytes(ins.op), hash);
+		hash = hash_bytes(object_bytes(ins.arg), hash);
+		hash = hash_bytes(object_bytes(ins.value), hash);
+	}
+	return hash;
+}
+
+struct PositionRequirements
+{
+	std::vector<std::string> attacking, defensive;
+	std::map<std::string, std::string> position_to_calculation;
+	std::map<std::string, Formula> position_to_formula;
+	// Every formula merged into one graph, with the node for each position in the order of position_to_formula.
+	FormulaGraph graph;
+	std::vector<std::uint32_t> position_nodes;
+	// Positions are identified by their index in position_to_formula. These are the IDs for each slot on each side.
+	std::vector<std::uint32_t> attacking_ids, defensive_ids;
+	// Identifies the stats, sides and compiled formulas, so a scorer generated from them can be matched up.
+	std::uint64_t hash = 0u;
+	std::vector<std::string> errors;
+};
+
+PositionRequirements parse_position_requirements(std::istream& iss, const std::vector<std::string>& stat_names)
+{
+	const PhaseTimer timer{ ProfilePhase::CompositionParse };
+	PositionRequirements result;
+	while (!iss.eof())
+	{
+		std::string line_data;
+		std::getline(iss, line_data);
+		std::string_view line = line_data;
+		if (line.empty() || line.front() == '#')
+		{
+			continue;
+		}
+
+		const auto eq_pos = line.find('=');
+		if (eq_pos < line.size())
+		{
+			std::string_view val = trim_whitespace(line.substr(0, eq_pos));
+			std::string_view calculation = trim_whitespace(line.substr(eq_pos + 1));
+			result.position_to_calculation.insert(std::pair{ std::string{val},std::string{calculation} });
+			continue;
+		}
+
+		const auto colon_pos = line.find(':');
+		if (colon_pos < line.size())
+		{
+			constexpr int UNINTIALIZED = 0;
+			constexpr int OFFENCE = 1;
+			constexpr int DEFENCE = 2;
+
+			std::string_view prefix = trim_whitespace(line.substr(0, colon_pos));
+			int status = UNINTIALIZED;
+			switch (prefix.front())
+			{
+			case 'o':
+			case 'O':
+				status = OFFENCE;
+				assert(result.attacking.empty());
+				break;
+			case 'd':
+			case 'D':
+				status = DEFENCE;
+				assert(result.defensive.empty());
+				break;
+			default:
+				break;
+			}
+
+			if (status == UNINTIALIZED) continue;
+
+			std::istringstream positions{ std::string{ line.substr(colon_pos + 1) } };
+			std::vector<std::string>& target = status == OFFENCE ? result.attacking : result.defensive;
+			std::copy(std::istream_iterator<std::string>{positions}, std::istream_iterator<std::string>{}, std::back_inserter(target));
+		}
+	}
+
+	if (result.attacking.size() != result.defensive.size())
+	{
+		result.errors.push_back(std::format("Found {} offensive positions but {} defensive ones", result.attacking.size(), result.defensive.size()));
+	}
+
+	// Positions without a calculation are scored by the stat with the same name.
+	FormulaCompiler compiler{ stat_names };
+	for (const std::vector<std::string>* positions : { &result.attacking, &result.defensive })
+	{
+		for (const std::string& pos : *positions)
+		{
+			if (result.position_to_formula.contains(pos)) continue;
+			auto calc_it = result.position_to_calculation.find(pos);
+			const std::string_view calculation = calc_it != end(result.position_to_calculation) ? std::string_view{ calc_it->second } : std::string_view{ pos };
+			std::string error;
+			std::optional<Formula> formula = compiler.compile(calculation, error);
+			if (formula.has_value())
+			{
+				result.position_to_formula.insert(std::pair{ pos, std::move(formula.value()) });
+			}
+			else
+			{
+				result.errors.push_back(std::format("Position {}: {}", pos, error));
+			}
+		}
+	}
+	std::uint64_t hash = hash_bytes({});
+	const std::array<const std::vector<std::string>*, 3> hashed_names{ &stat_names, &result.attacking, &result.defensive };
+	for (const std::vector<std::string>* names : hashed_names)
+	{
+		for (const std::string& name : *names) hash = hash_bytes(std::string_view{ name.c_str(), name.size() + 1u }, hash);
+		hash = hash_bytes(object_bytes(names->size()), hash);
+	}
+	if (result.errors.empty())
+	{
+		auto position_id = [&result](const std::string& pos)
+			{
+				return static_cast<std::uint32_t>(std::distance(begin(result.position_to_formula), result.position_to_formula.find(pos)));
+			};
+		std::ranges::transform(result.attacking, std::back_inserter(result.attacking_ids), position_id);
+		std::ranges::transform(result.defensive, std::back_inserter(result.defensive_ids), position_id);
+	}
+	for (const auto& [pos, formula] : result.position_to_formula)
+	{
+		result.position_nodes.push_back(result.graph.add(formula));
+		hash = hash_bytes(std::string_view{ pos.c_str(), pos.size() + 1u }, hash);
+		hash = hash_bytes(object_bytes(hash_formula(formula)), hash);
+	}
+	result.hash = hash;
+	return result;
+}
+
+// Merges the compositions of a draft into one whose slots are each team's slots in turn, so the roster is scored
+// once for every team. A position with the same name and compiled calculation in several teams is shared; one
+// calculated differently by a later team is renamed with the team's number, as in "QB#2".
+PositionRequirements merge_draft_requirements(std::span<const PositionRequirements> teams)
+{
+	PositionRequirements result;
+	std::map<std::string, std::uint64_t> formula_hashes;
+	std::uint64_t hash = hash_bytes({});
+	for (std::size_t team = 0u; team < teams.size(); ++team)
+	{
+		const PositionRequirements& requirements = teams[team];
+		result.errors.insert(end(result.errors), begin(requirements.errors), end(requirements.errors));
+		if (!requirements.errors.empty()) continue;
+
+		std::map<std::string, std::string> merged_names;
+		for (const auto& [pos, formula] : requirements.position_to_formula)
+		{
+			const std::uint64_t formula_hash = hash_formula(formula);
+			auto hash_it = formula_hashes.find(pos);
+			const std::string name = hash_it == end(formula_hashes) || hash_it->second == formula_hash ? pos : std::format("{}#{}", pos, team + 1u);
+			formula_hashes.insert(std::pair{ name, formula_hash });
+			result.position_to_formula.insert(std::pair{ name, formula });
+			merged_names.insert(std::pair{ pos, name });
+		}
+		std::ranges::transform(requirements.attacking, std::back_inserter(result.attacking), [&merged_names](const std::string& pos) {return merged_names.at(pos); });
+		std::ranges::transform(requirements.defensive, std::back_inserter(result.defensive), [&merged_names](const std::string& pos) {return merged_names.at(pos); });
+		hash = hash_bytes(object_bytes(requirements.hash), hash);
+	}
+
+	auto position_id = [&result](const std::string& pos)
+		{
+			return static_cast<std::uint32_t>(std::distance(begin(result.position_to_formula), result.position_to_formula.find(pos)));
+		};
+	std::ranges::transform(result.attacking, std::back_inserter(result.attacking_ids), position_id);
+	std::ranges::transform(result.defensive, std::back_inserter(result.defensive_ids), position_id);
+	for (const auto& [pos, formula] : result.position_to_formula)
+	{
+		result.position_nodes.push_back(result.graph.add(formula));
+	}
+	result.hash = hash;
+	return result;
+}
+
+// Writes a C++ header that scores players for one composition with plain inline functions, for --generate-scorer.
+// Shared subexpressions and folded constants come from the composition's graph, and each is written as a local so
+// the compiler sees exactly the operations the graph evaluates, in the same order, giving the same scores.
+std::string generate_scorer(const PositionRequirements& requirements, const std::vector<std::string>& stat_names, std::string_view source)
+{
+	// Names become identifiers by replacing other characters with underscores, never two in a row since those are
+	// reserved. Stat fields may not be keywords or start with an underscore, so those get a prefix, and any
+	// identifier already taken gets a number.
+	auto identifier = [](std::string_view name)
+		{
+			std::string result;
+			for (char c : name)
+			{
+				if (std::isalnum(static_cast<unsigned char>(c))) result += c;
+				else if (result.empty() || result.back() != '_') result += '_';
+			}
+			return result;
+		};
+	static constexpr std::string_view KEYWORDS[]{ "alignas", "alignof", "and", "and_eq", "asm", "auto",
+		"bitand", "bitor", "bool", "break", "case", "catch", "char", "char8_t", "char16_t", "char32_t", "class", "compl",
+		"concept", "const", "consteval", "constexpr", "constinit", "const_cast", "continue", "co_await", "co_return",
+		"co_yield", "decltype", "default", "delete", "do", "double", "dynamic_cast", "else", "enum", "explicit", "export",
+		"extern", "false", "float", "for", "friend", "goto", "if", "inline", "int", "long", "mutable", "namespace", "new",
+		"noexcept", "not", "not_eq", "nullptr", "operator", "or", "or_eq", "private", "protected", "public", "register",
+		"reinterpret_cast", "requires", "return", "short", "signed", "sizeof", "static", "static_assert", "static_cast",
+		"struct", "switch", "template", "this", "thread_local", "throw", "true", "try", "typedef", "typeid", "typename",
+		"union", "unsigned", "using", "virtual", "void", "volatile", "wchar_t", "while", "xor", "xor_eq", "final",
+		"override", "import", "module" };
+	auto unique = [](std::string name, std::vector<std::string>& taken)
+		{
+			if (std::ranges::find(taken, name) != end(taken))
+			{
+				const std::string_view separator = name.ends_with('_') ? "" : "_";
+				std::size_t n = 2u;
+				while (std::ranges::find(taken, std::format("{}{}{}", name, separator, n)) != end(taken)) ++n;
+				name = std::format("{}{}{}", name, separator, n);
+			}
+			taken.push_back(name);
+			return name;
+		};
+	// An ordinary string literal for any text, so no text can end it early. Other control characters are written in
+	// octal, which unlike hex stops after three digits.
+	auto string_literal = [](std::string_view text)
+		{
+			std::string result = "\"";
+			for (char c : text)
+			{
+				switch (c)
+				{
+				case '"': result += "\\\""; break;
+				case '\\': result += "\\\\"; break;
+				case '\n': result += "\\n"; break;
+				case '\t': result += "\\t"; break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20u || c == '\x7f') result += std::format("\\{:03o}", static_cast<unsigned int>(static_cast<unsigned char>(c)));
+					else result += c;
+					break;
+				}
+			}
+			return result + "\"";
+		};
+	auto quoted_list = [&string_literal](const std::vector<std::string_view>& names)
+		{
+			std::string result;
+			for (std::string_view name : names) result += std::format("{}{}", result.empty() ? "" : ", ", string_literal(name));
+			return result;
+		};
+	auto literal = [](double value)
+		{
+			if (std::isnan(value)) return std::string{ "std::numeric_limits<double>::quiet_NaN()" };
+			if (std::isinf(value)) return std::string{ value < 0.0 ? "-" : "" } + "std::numeric_limits<double>::infinity()";
+			return std::format("{:.17g}", value);
+		};
+
+	const std::vector<FormulaNode>& nodes = requirements.graph.nodes();
+	std::vector<std::string> stat_fields;
+	for (const std::string& stat : stat_names)
+	{
+		std::string field = identifier(stat);
+		if (field.empty() || !std::isalpha(static_cast<unsigned char>(field.front())) || std::ranges::find(KEYWORDS, field) != end(KEYWORDS))
+		{
+			field.insert(0u, field.empty() || field.front() != '_' ? "stat_" : "stat");
+		}
+		unique(std::move(field), stat_fields);
+	}
+
+	// The statements computing the given nodes, one local per node they need.
+	auto body = [&](std::span<const std::uint32_t> outputs)
+		{
+			std::vector<bool> needed(nodes.size(), false);
+			for (std::uint32_t output : outputs) needed[output] = true;
+			for (std::size_t id = nodes.size(); id-- > 0u;)
+			{
+				if (!needed[id]) continue;
+				for (std::uint32_t input : nodes[id].inputs) needed[input] = true;
+			}
+			std::string result;
+			for (std::size_t id = 0u; id < nodes.size(); ++id)
+			{
+				if (!needed[id]) continue;
+				const FormulaNode& node = nodes[id];
+				std::vector<std::string> in;
+				for (std::uint32_t input : node.inputs) in.push_back(std::format("v{}", input));
+				std::string expr;
+				switch (node.op)
+				{
+				case OpCode::Constant: expr = literal(node.value); break;
+				case OpCode::Stat: expr = std::format("static_cast<double>(s.{})", stat_fields[node.arg]); break;
+				case OpCode::Negate: expr = std::format("-{}", in[0]); break;
+				case OpCode::Not: expr = std::format("from_bool(!as_bool({}))", in[0]); break;
+				case OpCode::Add: expr = std::format("{} + {}", in[0], in[1]); break;
+				case OpCode::Subtract: expr = std::format("{} - {}", in[0], in[1]); break;
+				case OpCode::Multiply: expr = std::format("{} * {}", in[0], in[1]); break;
+				case OpCode::Divide: expr = std::format("{} / {}", in[0], in[1]); break;
+				case OpCode::Power: expr = std::format("std::pow({}, {})", in[0], in[1]); break;
+				case OpCode::Less: expr = std::format("from_bool({} < {})", in[0], in[1]); break;
+				case OpCode::Greater: expr = std::format("from_bool({} > {})", in[0], in[1]); break;
+				case OpCode::LessEqual: expr = std::format("from_bool({} <= {})", in[0], in[1]); break;
+				case OpCode::GreaterEqual: expr = std::format("from_bool({} >= {})", in[0], in[1]); break;
+				case OpCode::Equal: expr = std::format("from_bool(std::abs({} - {}) < 0.000001)", in[0], in[1]); break;
+				case OpCode::NotEqual: expr = std::format("from_bool(std::abs({} - {}) >= 0.000001)", in[0], in[1]); break;
+				case OpCode::And: expr = std::format("from_bool(as_bool({}) && as_bool({}))", in[0], in[1]); break;
+				case OpCode::Or: expr = std::format("from_bool(as_bool({}) || as_bool({}))", in[0], in[1]); break;
+				case OpCode::If: expr = std::format("as_bool({}) ? {} : {}", in[0], in[1], in[2]); break;
+				case OpCode::Min:
+				case OpCode::Max:
+				{
+					expr = in[0];
+					for (std::size_t i = 1u; i < in.size(); ++i) expr = std::format("std::{}({}, {})", node.op == OpCode::Min ? "min" : "max", expr, in[i]);
+					break;
+				}
+				case OpCode::Average:
+				{
+					expr = in[0];
+					for (std::size_t i = 1u; i < in.size(); ++i) expr += " + " + in[i];
+					expr = std::format("({}) / {}", expr, literal(static_cast<double>(in.size())));
+					break;
+				}
+				}
+				result += std::format("\t\tconst double v{} = {};\n", id, expr);
+			}
+			return result;
+		};
+
+	std::vector<std::string_view> positions;
+	for (const auto& [pos, formula] : requirements.position_to_formula) positions.push_back(pos);
+	const std::vector<std::string_view> offence{ begin(requirements.attacking), end(requirements.attacking) };
+	const std::vector<std::string_view> defence{ begin(requirements.defensive), end(requirements.defensive) };
+	const std::vector<std::string_view> stats{ begin(stat_names), end(stat_names) };
+
+	std::string out = std::format(
+		"// Generated by team_picker --generate-scorer from {}. Do not edit.\n"
+		"// Build team_picker with -DTEAM_PICKER_SCORER=\"\\\"<path to this file>\\\"\" to score this composition with it.\n"
+		"// Floating-point contraction must be off (the default for /fp:precise and -std=c++20) for scores to match.\n"
+		"#pragma once\n"
+		"#include <algorithm>\n#include <array>\n#include <cmath>\n#include <cstdint>\n#include <limits>\n#include <string_view>\n\n"
+		"namespace generated_scorer\n{{\n"
+		"\tconstexpr std::uint64_t COMPOSITION_HASH = 0x{:016x}ull;\n\n",
+		source, requirements.hash);
+	out += std::format("\tconstexpr std::array<std::string_view, {}> STAT_NAMES{{ {} }};\n", stats.size(), quoted_list(stats));
+	out += std::format("\tconstexpr std::size_t LINEUP_SIZE = {};\n", offence.size());
+	out += std::format("\tconstexpr std::array<std::string_view, LINEUP_SIZE> OFFENCE{{ {} }};\n", quoted_list(offence));
+	out += std::format("\tconstexpr std::array<std::string_view, LINEUP_SIZE> DEFENCE{{ {} }};\n", quoted_list(defence));
+	auto id_list = [](const std::vector<std::uint32_t>& ids)
+		{
+			std::string result;
+			for (std::uint32_t id : ids) result += std::format("{}{}", result.empty() ? "" : ", ", id);
+			return result;
+		};
+	out += "\t// Each slot's index in POSITIONS.\n";
+	out += std::format("\tconstexpr std::array<std::uint32_t, LINEUP_SIZE> OFFENCE_IDS{{ {} }};\n", id_list(requirements.attacking_ids));
+	out += std::format("\tconstexpr std::array<std::uint32_t, LINEUP_SIZE> DEFENCE_IDS{{ {} }};\n", id_list(requirements.defensive_ids));
+	out += std::format("\tconstexpr std::array<std::string_view, {}> POSITIONS{{ {} }};\n", positions.size(), quoted_list(positions));
+	// The calculations as written, so that --benchmark can compile them again and check this scorer against them.
+	out += std::format("\tconstexpr std::array<std::string_view, {}> CALCULATIONS{{", positions.size());
+	for (std::size_t p = 0u; p < positions.size(); ++p)
+	{
+		const auto calc_it = requirements.position_to_calculation.find(std::string{ positions[p] });
+		const std::string_view calculation = calc_it != end(requirements.position_to_calculation) ? std::string_view{ calc_it->second } : positions[p];
+		out += std::format("{} {}", p == 0u ? "" : ",", string_literal(calculation));
+	}
+	out += " };\n\n";
+
+	out += "\tstruct Stats\n\t{\n";
+	for (const std::string& field : stat_fields) out += std::format("\t\tint {} = 0;\n", field);
+	out += "\t};\n\n";
+	out += "\t// Columns are indexed by stat, then by player, as in the team data file.\n";
+	out += "\ttemplate <typename Columns>\n\tStats load_stats(const Columns& columns, std::size_t row)\n\t{\n\t\treturn Stats{ ";
+	for (std::size_t i = 0u; i < stat_fields.size(); ++i) out += std::format("{}columns[{}][row]", i == 0u ? "" : ", ", i);
+	out += " };\n\t}\n\n";
+	out += "\tinline bool as_bool(double val) { return std::abs(val) >= 0.5; }\n";
+	out += "\tinline double from_bool(bool val) { return val ? 1.0 : 0.0; }\n";
+
+	std::vector<std::string> function_names{ "score_positions" };
+	for (std::size_t p = 0u; p < positions.size(); ++p)
+	{
+		std::string name = identifier(positions[p]);
+		name = unique(std::format("score{}{}", name.starts_with('_') ? "" : "_", name), function_names);
+		const std::uint32_t node = requirements.position_nodes[p];
+		out += std::format("\n\tinline double {}(const Stats& s)\n\t{{\n{}\t\treturn v{};\n\t}}\n", name, body(std::span{ &node, 1u }), node);
+	}
+
+	out += std::format("\n\t// Every position's score, in the order of POSITIONS, computing shared parts once.\n"
+		"\tinline std::array<double, {}> score_positions(const Stats& s)\n\t{{\n{}\t\treturn {{ ", positions.size(), body(requirements.position_nodes));
+	for (std::size_t p = 0u; p < positions.size(); ++p) out += std::format("{}v{}", p == 0u ? "" : ", ", requirements.position_nodes[p]);
+	out += " };\n\t}\n}\n";
+	return out;
+}
+
+struct RosterPosition
+{
+	std::string name, offence, defence;
+	double offensive_score = 0.0;
+	double defensive_score = 0.0;
+	double total_score = 0.0;
+};
+
+enum class Unit : std::uint8_t
+{
+	Offence,
+	Defence
+};
+
+// Every player's scores, indexed by player ID, which is their row in the roster. A row of positions has a score for
+// each position ID; a row of offence or defence has one for each slot on that side, ready to copy into an assignment.
+// A matrix made by slots() owns no scores and reads some of another's slots instead.
+struct ScoreMatrix
+{
+	std::size_t num_positions = 0u;
+	std::size_t lineup_size = 0u;
+	std::vector<double> positions, offence, defence;
+	// For a view, the matrix whose scores it reads, and where its slots start in that matrix's rows.
+	const ScoreMatrix* base = nullptr;
+	std::size_t first_slot = 0u;
+
+	ScoreMatrix() = default;
+	ScoreMatrix(std::size_t num_players, const PositionRequirements& requirements)
+		: num_positions{ requirements.position_to_formula.size() }
+		, lineup_size{ requirements.attacking.size() }
+		, positions(num_players * num_positions)
+		, offence(num_players * lineup_size)
+		, defence(num_players * lineup_size)
+	{
+	}
+
+	std::span<const double> position_row(std::size_t player) const
+	{
+		const ScoreMatrix& owner = base != nullptr ? *base : *this;
+		return { owner.positions.data() + player * num_positions, num_positions };
+	}
+	std::span<const double> row(Unit unit, std::size_t player) const
+	{
+		const ScoreMatrix& owner = base != nullptr ? *base : *this;
+		const std::vector<double>& scores = unit == Unit::Offence ? owner.offence : owner.defence;
+		return { scores.data() + player * owner.lineup_size + first_slot, lineup_size };
+	}
+	double score(Unit unit, std::size_t player, std::size_t slot) const { return row(unit, player)[slot]; }
+	double max_score(std::size_t player) const { return std::ranges::max(row(Unit::Offence, player)) + std::ranges::max(row(Unit::Defence, player)); }
+
+	// A view of count slots on each side, starting from first, as a matrix of its own: one team's slots in a draft.
+	// Nothing is copied, so this matrix must outlive it and keep its scores.
+	ScoreMatrix slots(std::size_t first, std::size_t count) const
+	{
+		assert(base == nullptr && first + count <= lineup_size);
+		ScoreMatrix result;
+		result.num_positions = num_positions;
+		result.lineup_size = count;
+		result.base = this;
+		result.first_slot = first;
+		return result;
+	}
+
+	// Sets a player's scores from their score at each position (a position may be on both sides, or twice on one).
+	// Returns their max_score: the best offence score plus the best defence score.
+	double set_player(std::size_t player, std::span<const double> position_scores, const PositionRequirements& requirements)
+	{
+		assert(base == nullptr && position_scores.size() == num_positions);
+		std::ranges::copy(position_scores, begin(positions) + player * num_positions);
+		double offence_max = std::numeric_limits<double>::lowest();
+		double defence_max = std::numeric_limits<double>::lowest();
+		for (std::size_t slot = 0u; slot < lineup_size; ++slot)
+		{
+			offence[player * lineup_size + slot] = position_scores[requirements.attacking_ids[slot]];
+			defence[player * lineup_size + slot] = position_scores[requirements.defensive_ids[slot]];
+			offence_max = std::max(offence_max, offence[player * lineup_size + slot]);
+			defence_max = std::max(defence_max, defence[player * lineup_size + slot]);
+		}
+		return offence_max + defence_max;
+	}
+};
+
+// A player to choose from, by ID. Players are copied, sorted and pruned while picking, so they are kept small.
+struct PickTempData
+{
+	std::uint32_t id = 0u;
+	double max_score = 0.0;
+};
+
+// Everything the picker needs from a roster: names and scores by player ID, and the players, in ID order.
+struct PickData
+{
+	std::vector<std::string_view> names;
+	ScoreMatrix scores;
+	std::vector<PickTempData> players;
+};
+
+// Scores one player again, after their stats have changed.
+void rescore_player(PickData& data, const Roster& roster, std::size_t row, const PositionRequirements& requirements)
+{
+	std::vector<double> position_scores;
+	for (const std::vector<double>& column : requirements.graph.evaluate(roster, requirements.position_nodes, row, 1u))
+	{
+		position_scores.push_back(column.front());
+	}
+	assert(data.players[row].id == row);
+	data.players[row].max_score = data.scores.set_player(row, position_scores, requirements);
+	Log::trace("    Evaluating {}\n", data.names[row]);
+}
+
+// One column of scores per position, in the order of requirements.position_to_formula.
+using PositionScores = std::vector<std::vector<double>>;
+// As PositionScores, but viewing columns kept elsewhere, such as in the score cache.
+using PositionColumns = std::vector<std::span<const double>>;
+
+// Evaluates the output nodes for every row of the roster, on up to threads threads. The result does not depend on
+// the number of threads.
+std::vector<std::vector<double>> evaluate_all_rows(const FormulaGraph& graph, const Roster& roster, std::span<const std::uint32_t> outputs, std::size_t threads)
+{
+	std::vector<std::vector<double>> result(outputs.size(), std::vector<double>(roster.size()));
+	parallel_rows(roster.size(), PARALLEL_SCORE_ROWS, threads, [&](std::size_t first, std::size_t last)
+		{
+			std::vector<std::vector<double>> scores = graph.evaluate(roster, outputs, first, last - first);
+			for (std::size_t i = 0u; i < outputs.size(); ++i)
+			{
+				std::ranges::copy(scores[i], begin(result[i]) + first);
+			}
+		});
+	return result;
+}
+
+#if defined(TEAM_PICKER_SCORER)
+// Scores with the compiled-in scorer. Its positions are in the order of position_to_formula, which it was generated from.
+PositionScores score_positions_generated(const Roster& roster, std::size_t threads)
+{
+	Profile::count(ProfileCounter::FormulaEvaluations, generated_scorer::POSITIONS.size() * roster.size());
+	PositionScores result(generated_scorer::POSITIONS.size(), std::vector<double>(roster.size()));
+	parallel_rows(roster.size(), PARALLEL_SCORE_ROWS, threads, [&](std::size_t first, std::size_t last)
+		{
+			for (std::size_t row = first; row < last; ++row)
+			{
+				const auto scores = generated_scorer::score_positions(generated_scorer::load_stats(roster.columns, row));
+				for (std::size_t p = 0u; p < scores.size(); ++p) result[p][row] = scores[p];
+			}
+		});
+	return result;
+}
+#endif
+
+PositionScores score_positions(const Roster& roster, const PositionRequirements& requirements, std::size_t threads = 1u)
+{
+	const PhaseTimer timer{ ProfilePhase::Scoring };
+#if defined(TEAM_PICKER_SCORER)
+	if (requirements.hash == generated_scorer::COMPOSITION_HASH)
+	{
+		Log::info("Scoring with the compiled-in scorer\n");
+		return score_positions_generated(roster, threads);
+	}
+#endif
+	return evaluate_all_rows(requirements.graph, roster, requirements.position_nodes, threads);
+}
+
+// Collects the scores from score_positions into a ScoreMatrix, with every player available to pick. Each player's
+// rows are filled in on their own, so they are spread over up to threads threads.
+PickData to_pick_data(const Roster& roster, const PositionRequirements& requirements, const PositionColumns& scores, std::size_t threads = 1u)
+{
+	const PhaseTimer timer{ ProfilePhase::Scoring };
+	assert(scores.size() == requirements.position_to_formula.size());
+	PickData result{ roster.names, ScoreMatrix{ roster.size(), requirements }, std::vector<PickTempData>(roster.size()) };
+	parallel_rows(roster.size(), PARALLEL_SCORE_ROWS, threads, [&](std::size_t first, std::size_t last)
+		{
+			std::vector<double> position_scores(scores.size());
+			for (std::size_t row = first; row < last; ++row)
+			{
+				for (std::size_t pos = 0u; pos < scores.size(); ++pos)
+				{
+					position_scores[pos] = scores[pos][row];
+				}
+				result.players[row] = PickTempData{ static_cast<std::uint32_t>(row), result.scores.set_player(row, position_scores, requirements) };
+			}
+		});
+	if (Log::enabled(LogLevel::Trace))
+	{
+		for (std::string_view name : roster.names) Log::trace("    Evaluating {}\n", name);
+	}
+	return result;
+}
+
+PickData to_pick_data(const Roster& roster, const PositionRequirements& requirements, const PositionScores& scores, std::size_t threads = 1u)
+{
+	return to_pick_data(roster, requirements, PositionColumns(begin(scores), end(scores)), threads);
+}
+
+PickData to_pick_data(const Roster& roster, const PositionRequirements& requirements, std::size_t threads = 1u)
+{
+	return to_pick_data(roster, requirements, score_positions(roster, requirements, threads), threads);
+}
+
+// How many of the players already kept prune_dominated_players checks each player against, at most.
+constexpr std::size_t MAX_DOMINANCE_CHECKS = 1024u;
+
+// Removes players who can never be needed in a best line up: those with at least lineup_size other players who
+// score at least as well at every position. At least one of those is always on the bench, free to take the
+// player's place for no loss. Returns the number of players removed.
+// Dominance implies a higher total over all positions, so players are checked in order of that total against the
+// players already kept. A removed player's dominators include at least lineup_size kept ones, so the others never
+// need checking. Players with equal totals are checked in the order of data, so of two identical players only the
+// later can be removed by the other.
+// Only the first MAX_DOMINANCE_CHECKS players kept, the best all-rounders and so the likeliest dominators, are
+// checked against, so the cost stays linear in the roster when few players are dominated. A player who would need
+// a later one is kept, which is always safe, only slower to search.
+// When the best num_lineups line ups are wanted, lineup_size + num_lineups - 1 dominators are needed: then any line
+// up starting the player has num_lineups others, each swapping in a different dominator, that are at least as good.
+std::size_t prune_dominated_players(std::vector<PickTempData>& data, const ScoreMatrix& matrix, std::size_t num_lineups = 1u)
+{
+	const PhaseTimer timer{ ProfilePhase::Pruning };
+	const std::size_t needed_dominators = matrix.lineup_size + num_lineups - 1u;
+	if (data.size() <= needed_dominators) return 0u;
+
+	// Copied in the order of data, so the players already kept are read from one block.
+	const std::size_t num_positions = matrix.num_positions;
+	std::vector<double> scores;
+	scores.reserve(data.size() * num_positions);
+	std::vector<double> totals;
+	totals.reserve(data.size());
+	for (const PickTempData& ptd : data)
+	{
+		const std::span<const double> row = matrix.position_row(ptd.id);
+		scores.insert(end(scores), begin(row), end(row));
+		totals.push_back(std::accumulate(begin(row), end(row), 0.0));
+	}
+
+	std::vector<std::size_t> order(data.size());
+	std::iota(begin(order), end(order), std::size_t{ 0 });
+	std::ranges::stable_sort(order, std::greater<double>{}, [&totals](std::size_t i) {return totals[i]; });
+
+	auto dominates = [&scores, num_positions](std::size_t better, std::size_t worse)
+		{
+			const double* b = scores.data() + better * num_positions;
+			const double* w = scores.data() + worse * num_positions;
+			for (std::size_t i = 0u; i < num_positions; ++i)
+			{
+				if (b[i] < w[i]) return false;
+			}
+			return true;
+		};
+
+	std::vector<std::size_t> kept;
+	std::vector<char> removed(data.size(), false);
+	for (std::size_t player : order)
+	{
+		std::size_t dominators = 0u;
+		const auto last = begin(kept) + static_cast<std::ptrdiff_t>(std::min(kept.size(), MAX_DOMINANCE_CHECKS));
+		for (auto it = begin(kept); it != last && dominators < needed_dominators; ++it)
+		{
+			if (dominates(*it, player)) ++dominators;
+		}
+		if (dominators < needed_dominators)
+		{
+			kept.push_back(player);
+		}
+		else
+		{
+			removed[player] = true;
+		}
+	}
+
+	const std::size_t num_removed = data.size() - kept.size();
+	std::vector<PickTempData> remaining;
+	remaining.reserve(kept.size());
+	for (std::size_t i = 0u; i < data.size(); ++i)
+	{
+		if (!removed[i]) remaining.push_back(std::move(data[i]));
+	}
+	data = std::move(remaining);
+	return num_removed;
+}
+
+constexpr std::size_t STREAM_BATCH_ROWS = 4096u;
+
+// Reads the rest of a roster stream a batch at a time, keeping only players who could be needed in a best line up.
+// For every pairing of an offensive and a defensive position, the lineup_size best players at that pair are kept.
+// Anyone else has, at the pair they would play, lineup_size kept players who score at least as well there. One of
+// those is always on the bench, free to take their place for no loss. Memory depends on the number of position
+// pairs, not the roster size. For the best num_lineups line ups, num_lineups - 1 more are kept at each pair, as in
+// prune_dominated_players.
+Roster stream_top_players(RosterStream& stream, const PositionRequirements& requirements, std::size_t num_lineups = 1u)
+{
+	const PhaseTimer timer{ ProfilePhase::RosterLoad };
+	struct Candidate
+	{
+		std::string_view name;
+		std::vector<int> stats;
+		std::size_t num_heaps = 0u;
+	};
+
+	std::vector<std::string_view> positions;
+	for (const auto& [pos, formula] : requirements.position_to_formula)
+	{
+		positions.push_back(pos);
+	}
+	auto side_indices = [&positions](const std::vector<std::string>& side)
+		{
+			std::vector<std::size_t> result;
+			for (std::size_t i = 0u; i < positions.size(); ++i)
+			{
+				if (std::ranges::find(side, positions[i]) != end(side)) result.push_back(i);
+			}
+			return result;
+		};
+	std::vector<std::pair<std::size_t, std::size_t>> pairs;
+	for (std::size_t off : side_indices(requirements.attacking))
+	{
+		for (std::size_t def : side_indices(requirements.defensive))
+		{
+			pairs.emplace_back(off, def);
+		}
+	}
+
+	// Min-heaps of (score, player) so the worst kept player at each pair is at the front.
+	const std::size_t heap_size = requirements.attacking.size() + num_lineups - 1u;
+	std::vector<std::vector<std::pair<double, std::size_t>>> heaps(pairs.size());
+	std::map<std::size_t, Candidate> candidates;
+	std::vector<std::vector<double>> scores;
+
+	Roster& batch = stream.batch;
+	std::size_t num_read = 0u;
+	for (bool more = true; more;)
+	{
+		batch.names.clear();
+		for (std::vector<int>& column : batch.columns) column.clear();
+		while (batch.size() < STREAM_BATCH_ROWS)
+		{
+			const std::optional<std::string_view> name = stream.lines.next();
+			if (!name.has_value())
+			{
+				more = false;
+				break;
+			}
+			get_player(stream.lines, name.value(), batch);
+		}
+		trace_players_read(batch);
+
+		scores = requirements.graph.evaluate(batch, requirements.position_nodes, 0u, batch.size());
+
+		for (std::size_t row = 0u; row < batch.size(); ++row)
+		{
+			const std::size_t player = num_read + row;
+			std::size_t num_heaps = 0u;
+			for (std::size_t h = 0u; h < pairs.size(); ++h)
+			{
+				std::vector<std::pair<double, std::size_t>>& heap = heaps[h];
+				const double score = scores[pairs[h].first][row] + scores[pairs[h].second][row];
+				if (heap.size() == heap_size)
+				{
+					if (heap_size == 0u || score <= heap.front().first) continue;
+					std::ranges::pop_heap(heap, std::greater<>{});
+					auto evicted = candidates.find(heap.back().second);
+					if (--evicted->second.num_heaps == 0u) candidates.erase(evicted);
+					heap.pop_back();
+				}
+				heap.emplace_back(score, player);
+				std::ranges::push_heap(heap, std::greater<>{});
+				++num_heaps;
+			}
+			if (num_heaps == 0u) continue;
+
+			Candidate candidate{ batch.names[row], {}, num_heaps };
+			candidate.stats.reserve(batch.columns.size());
+			for (const std::vector<int>& column : batch.columns) candidate.stats.push_back(column[row]);
+			candidates.emplace(player, std::move(candidate));
+		}
+		num_read += batch.size();
+	}
+
+	Roster result;
+	result.source = batch.source;
+	result.stat_names = batch.stat_names;
+	result.errors = std::move(batch.errors);
+	result.columns.resize(result.stat_names.size());
+	for (const auto& [player, candidate] : candidates)
+	{
+		result.names.push_back(candidate.name);
+		for (std::size_t i = 0u; i < result.columns.size(); ++i)
+		{
+			result.columns[i].push_back(candidate.stats[i]);
+		}
+	}
+	Log::info("Kept {} of {} players who could be in the best line up.\n", result.size(), num_read);
+	return result;
+}
+
+// FNV-1a, continuing from hash so that several pieces can be combined.
+// A parsed roster and position score columns saved between runs. The roster is keyed by the size and
+// modification time of the team data file, falling back to a hash of its contents, and each column by a hash of
+// its formula, so tweaking a composition only recomputes the positions whose calculation changed.
+struct ScoreCache
+{
+	// One position's scores for every player, read in place from the cache file or scored this run.
+	struct Column
+	{
+		std::uint64_t hash = 0u;
+		std::span<const double> scores;
+		std::shared_ptr<const void> owner; // The mapped cache file or the vector holding scores.
+	};
+
+	std::uint64_t roster_hash = 0u;
+	std::uint64_t roster_size = 0u;
+	std::int64_t roster_time = 0;
+	bool roster_cached = false;
+	bool changed = false;
+	std::vector<Column> columns;
+};
+
+constexpr std::uint64_t SCORE_CACHE_MAGIC = 0x3245484341435054ull; // "TPCACHE2", little-endian.
+constexpr std::size_t MAX_CACHED_COLUMNS = 64u;
+
+// Reads from the front of a block of bytes, failing rather than running off the end.
+class ByteReader
+{
+public:
+	explicit ByteReader(std::string_view bytes) : m_bytes{ bytes }, m_size{ bytes.size() } {}
+
+	template <typename T>
+	bool read(std::span<T> out)
+	{
+		if (m_bytes.size() < out.size_bytes()) return false;
+		std::memcpy(out.data(), m_bytes.data(), out.size_bytes());
+		m_bytes.remove_prefix(out.size_bytes());
+		return true;
+	}
+
+	template <typename T>
+	bool read(T& value) { return read(std::span<T>{ &value, 1u }); }
+
+	std::optional<std::string_view> read_string()
+	{
+		std::uint64_t length = 0u;
+		if (!read(length) || m_bytes.size() < length) return std::nullopt;
+		const std::string_view result = m_bytes.substr(0u, static_cast<std::size_t>(length));
+		m_bytes.remove_prefix(result.size());
+		return result;
+	}
+
+	// The next count values where they lie, which must be suitably aligned in memory.
+	template <typename T>
+	std::optional<std::span<const T>> view(std::size_t count)
+	{
+		if (m_bytes.size() / sizeof(T) < count || reinterpret_cast<std::uintptr_t>(m_bytes.data()) % alignof(T) != 0u) return std::nullopt;
+		const std::span<const T> result{ reinterpret_cast<const T*>(m_bytes.data()), count };
+		m_bytes.remove_prefix(result.size_bytes());
+		return result;
+	}
+
+	// Skips the padding that brings the offset from the start up to a multiple of alignment.
+	bool skip_padding(std::size_t alignment)
+	{
+		const std::size_t padding = (alignment - (m_size - m_bytes.size()) % alignment) % alignment;
+		if (m_bytes.size() < padding) return false;
+		m_bytes.remove_prefix(padding);
+		return true;
+	}
+
+	std::size_t remaining() const { return m_bytes.size(); }
+
+private:
+	std::string_view m_bytes;
+	std::size_t m_size = 0u;
+};
+
+// Returns the cached roster if the file is a valid cache for this team data. The team data is hashed and compared
+// with the cache's hash, unless trust_time is set and its size and modification time match the cache's: that skips
+// the hash, but an edit that keeps the size within the file system's timestamp resolution goes unnoticed. Score
+// columns are left in place in the file, which the cache keeps mapped; the roster itself is copied out.
+std::optional<Roster> read_score_cache(std::shared_ptr<const MappedFile> file, std::string_view roster_text, std::int64_t roster_time, bool trust_time, ScoreCache& cache)
+{
+	ByteReader reader{ file->contents() };
+	std::uint64_t magic = 0u, cached_hash = 0u, cached_size = 0u, num_stats = 0u, num_players = 0u, num_columns = 0u;
+	std::int64_t cached_time = 0;
+	if (!reader.read(magic) || magic != SCORE_CACHE_MAGIC) return std::nullopt;
+	if (!reader.read(cached_hash) || !reader.read(cached_size) || !reader.read(cached_time)) return std::nullopt;
+	const bool trusted = trust_time && cached_size == roster_text.size() && cached_time == roster_time;
+	if (!trusted && (cached_size != roster_text.size() || cached_hash != hash_bytes(roster_text))) return std::nullopt;
+	if (!reader.read(num_stats) || !reader.read(num_players) || !reader.read(num_columns)) return std::nullopt;
+	if (num_stats > reader.remaining() || num_players > reader.remaining() || num_columns > MAX_CACHED_COLUMNS) return std::nullopt;
+
+	Roster roster;
+	for (std::uint64_t i = 0u; i < num_stats; ++i)
+	{
+		const std::optional<std::string_view> stat = reader.read_string();
+		if (!stat.has_value()) return std::nullopt;
+		roster.stat_names.emplace_back(stat.value());
+	}
+	std::string name_text;
+	std::vector<std::size_t> name_ends;
+	name_ends.reserve(static_cast<std::size_t>(num_players));
+	for (std::uint64_t i = 0u; i < num_players; ++i)
+	{
+		const std::optional<std::string_view> name = reader.read_string();
+		if (!name.has_value()) return std::nullopt;
+		name_text.append(name.value());
+		name_ends.push_back(name_text.size());
+	}
+	roster.source = MappedFile::from_string(std::move(name_text));
+	roster.names.reserve(name_ends.size());
+	for (std::size_t start = 0u; std::size_t end : name_ends)
+	{
+		roster.names.push_back(roster.source->contents().substr(start, end - start));
+		start = end;
+	}
+	roster.columns.resize(roster.stat_names.size());
+	for (std::vector<int>& column : roster.columns)
+	{
+		column.resize(roster.size());
+		if (!reader.read(std::span{ column })) return std::nullopt;
+	}
+
+	if (!reader.skip_padding(alignof(double))) return std::nullopt;
+	std::vector<ScoreCache::Column> columns(static_cast<std::size_t>(num_columns));
+	for (ScoreCache::Column& column : columns)
+	{
+		if (!reader.read(column.hash)) return std::nullopt;
+		const std::optional<std::span<const double>> scores = reader.view<double>(roster.size());
+		if (!scores.has_value()) return std::nullopt;
+		column.scores = scores.value();
+		column.owner = file;
+	}
+
+	cache.roster_hash = cached_hash;
+	cache.roster_size = cached_size;
+	cache.roster_time = roster_time;
+	cache.roster_cached = true;
+	// Touched but unchanged team data is recorded under its new time, so with trust_time it is not hashed next run.
+	cache.changed = cached_time != roster_time;
+	cache.columns = std::move(columns);
+	return roster;
+}
+
+// The team data file's modification time as a plain count, or 0 if it cannot be read.
+std::int64_t file_time(const std::filesystem::path& path)
+{
+	std::error_code error;
+	const std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+	return error ? 0 : static_cast<std::int64_t>(time.time_since_epoch().count());
+}
+
+// As load_roster, but the roster is read from the cache at cache_path instead if the team data has not changed (see
+// read_score_cache for trust_time).
+std::optional<Roster> load_roster(const std::filesystem::path& path, const std::filesystem::path& cache_path, bool trust_time, ScoreCache& cache, std::size_t threads = 1u)
+{
+	const PhaseTimer timer{ ProfilePhase::RosterLoad };
+	std::shared_ptr<const MappedFile> source = MappedFile::open(path);
+	if (source == nullptr) return std::nullopt;
+	const std::int64_t roster_time = file_time(path);
+	if (std::shared_ptr<const MappedFile> cache_file = MappedFile::open(cache_path))
+	{
+		std::optional<Roster> cached = read_score_cache(std::move(cache_file), source->contents(), roster_time, trust_time, cache);
+		if (cached.has_value())
+		{
+			Log::info("Read {} players from the cache\n", cached->size());
+			return cached;
+		}
+	}
+	cache = ScoreCache{ hash_bytes(source->contents()), source->contents().size(), roster_time, false, true, {} };
+	return parse_roster(std::move(source), threads);
+}
+
+// As score_positions, but columns whose formula is in the cache are read from it rather than evaluated. New columns
+// are added to the front of the cache, and the least recently used dropped once there are MAX_CACHED_COLUMNS. The
+// result views the cache's columns, in the mapped file where they were cached, so it is valid while the cache is.
+PositionColumns score_positions(const Roster& roster, const PositionRequirements& requirements, ScoreCache& cache, std::size_t threads = 1u)
+{
+	const PhaseTimer timer{ ProfilePhase::Scoring };
+	std::vector<ScoreCache::Column> columns;
+	std::vector<std::size_t> column_of_position;
+	std::size_t num_reused = 0u;
+	// Formulas missing from the cache are scored together afterwards, so they still share subexpressions.
+	std::vector<std::uint32_t> missing_nodes;
+	std::vector<std::size_t> missing_columns;
+	for (std::size_t p = 0u; const auto& [pos, formula] : requirements.position_to_formula)
+	{
+		const std::uint64_t hash = hash_formula(formula);
+		auto in_columns = [hash](const ScoreCache::Column& column) {return column.hash == hash; };
+		if (auto it = std::ranges::find_if(columns, in_columns); it != end(columns))
+		{
+			column_of_position.push_back(std::distance(begin(columns), it));
+		}
+		else if (auto it = std::ranges::find_if(cache.columns, in_columns); it != end(cache.columns))
+		{
+			++num_reused;
+			column_of_position.push_back(columns.size());
+			columns.push_back(std::move(*it));
+			cache.columns.erase(it);
+		}
+		else
+		{
+			missing_nodes.push_back(requirements.position_nodes[p]);
+			missing_columns.push_back(columns.size());
+			column_of_position.push_back(columns.size());
+			columns.push_back(ScoreCache::Column{ hash, {}, nullptr });
+		}
+		++p;
+	}
+	if (!missing_nodes.empty())
+	{
+		std::vector<std::vector<double>> scored = evaluate_all_rows(requirements.graph, roster, missing_nodes, threads);
+		for (std::size_t i = 0u; i < missing_columns.size(); ++i)
+		{
+			auto owner = std::make_shared<const std::vector<double>>(std::move(scored[i]));
+			columns[missing_columns[i]].scores = *owner;
+			columns[missing_columns[i]].owner = std::move(owner);
+		}
+		cache.changed = true;
+	}
+
+	PositionColumns result;
+	result.reserve(column_of_position.size());
+	for (std::size_t column : column_of_position) result.push_back(columns[column].scores);
+	Log::info("Reused {} of {} position scores from the cache\n", num_reused, result.size());
+
+	for (ScoreCache::Column& column : cache.columns)
+	{
+		if (columns.size() == MAX_CACHED_COLUMNS) break;
+		columns.push_back(std::move(column));
+	}
+	cache.columns = std::move(columns);
+	return result;
+}
+
+// Writes to a temporary file and renames it over the old cache, so a reader never sees half a file. The cache is
+// taken by value and released before the rename, since its columns may still map the old file, which Windows
+// will not replace.
+bool save_score_cache(const std::filesystem::path& cache_path, const Roster& roster, ScoreCache cache)
+{
+	std::string bytes;
+	auto write = [&bytes]<typename T>(std::span<const T> values)
+		{
+			bytes.append(reinterpret_cast<const char*>(values.data()), values.size_bytes());
+		};
+	auto write_value = [&write](std::uint64_t value) {write(std::span<const std::uint64_t>{ &value, 1u }); };
+	auto write_string = [&bytes, &write_value](std::string_view text)
+		{
+			write_value(text.size());
+			bytes.append(text);
+		};
+
+	write_value(SCORE_CACHE_MAGIC);
+	write_value(cache.roster_hash);
+	write_value(cache.roster_size);
+	write_value(static_cast<std::uint64_t>(cache.roster_time));
+	write_value(roster.stat_names.size());
+	write_value(roster.size());
+	write_value(cache.columns.size());
+	for (const std::string& stat : roster.stat_names) write_string(stat);
+	for (std::string_view name : roster.names) write_string(name);
+	for (const std::vector<int>& column : roster.columns) write(std::span{ column });
+	// Scores are aligned so that they can be read in place.
+	bytes.append((alignof(double) - bytes.size() % alignof(double)) % alignof(double), '\0');
+	for (const ScoreCache::Column& column : cache.columns)
+	{
+		write_value(column.hash);
+		write(column.scores);
+	}
+	cache = ScoreCache{};
+
+	std::filesystem::path temp_path = cache_path;
+	temp_path += ".tmp";
+	{
+		std::ofstream output{ temp_path, std::ios::binary | std::ios::trunc };
+		if (!output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()))) return false;
+	}
+	std::error_code error;
+	std::filesystem::rename(temp_path, cache_path, error);
+	if (error)
+	{
+		std::filesystem::remove(temp_path, error);
+		return false;
+	}
+	return true;
+}
+
+enum class AssignmentMethod
+{
+	Hungarian,
+	Exhaustive
+};
+
+struct PickOptions
+{
+	AssignmentMethod assignment = AssignmentMethod::Hungarian;
+	bool exact = false;
+	std::optional<std::chrono::milliseconds> exact_time_limit;
+	std::size_t threads = 0u; // 0 means one per hardware thread.
+	std::optional<std::chrono::milliseconds> time_budget;
+};
+
+// Slots index requirements.attacking or defensive, depending on the side.
+struct PositionDescription
+{
+	std::uint32_t slot = 0u;
+	double score = 0.0;
+};
+
+struct StartingPositionDescription
+{
+	std::uint32_t player = 0u; // ID
+	PositionDescription offence, defence;
+	double score = 0.0f;
+};
+
+// An arrangement of players on one side: the position of each player, in order, and the total score.
+using SideArrangement = std::pair<std::vector<PositionDescription>, double>;
+
+// Tries every arrangement. Slots are marked used as the recursion goes rather than copied, and a slot with the same
+// position as an earlier free slot is skipped, since it would score the same.
+double find_best_positions_exhaustive(std::span<const PickTempData> players, const ScoreMatrix& matrix, Unit unit,
+	std::span<const std::uint32_t> position_ids, std::vector<char>& used, std::vector<PositionDescription>& best)
+{
+	Profile::count(ProfileCounter::ExhaustiveNodes);
+	best.clear();
+	if (players.empty()) return 0.0;
+
+	std::vector<PositionDescription> rest;
+	double best_overall_score = std::numeric_limits<double>::lowest();
+	const std::span<const double> scores = matrix.row(unit, players.front().id);
+	for (std::uint32_t slot = 0u; slot < position_ids.size(); ++slot)
+	{
+		bool repeated = used[slot];
+		for (std::uint32_t earlier = 0u; earlier < slot && !repeated; ++earlier)
+		{
+			repeated = !used[earlier] && position_ids[earlier] == position_ids[slot];
+		}
+		if (repeated) continue;
+
+		used[slot] = true;
+		const double total = scores[slot] + find_best_positions_exhaustive(players.subspan(1), matrix, unit, position_ids, used, rest);
+		used[slot] = false;
+		if (total > best_overall_score)
+		{
+			best.assign(begin(rest), end(rest));
+			best.insert(begin(best), PositionDescription{ slot, scores[slot] });
+			best_overall_score = total;
+		}
+	}
+	return best_overall_score;
+}
+
+SideArrangement find_best_positions_exhaustive(std::span<const PickTempData> players, const ScoreMatrix& matrix, Unit unit, std::span<const std::uint32_t> position_ids)
+{
+	assert(players.size() == position_ids.size());
+	std::vector<char> used(position_ids.size(), false);
+	SideArrangement result;
+	result.second = find_best_positions_exhaustive(players, matrix, unit, position_ids, used, result.first);
+	return result;
+}
+
+// Solves the assignment problem on a dense rows*columns matrix (scores[row * columns + column], rows <= columns)
+// using the Hungarian method with potentials, maximising the total score. Every row gets a distinct column.
+// Solving is O(rows^2 * columns). The potentials are kept, so on a square matrix one row can be replaced
+// and re-solved with a single augmenting path in O(n^2).
+class AssignmentSolver
+{
+public:
+	AssignmentSolver(std::vector<double> scores, std::size_t rows, std::size_t columns)
+		: m_scores{ std::move(scores) }
+		, m_rows{ rows }
+		, m_columns{ columns }
+		, m_row_potential(rows + 1, 0.0)
+		, m_column_potential(columns + 1, 0.0)
+		, m_column_owner(columns + 1, 0u)
+		, m_row_column(rows, 0u)
+	{
+		assert(rows <= columns);
+		assert(m_scores.size() == rows * columns);
+		for (std::size_t row = 1u; row <= rows; ++row)
+		{
+			augment(row);
+		}
+		update_row_columns();
+	}
+
+	std::size_t rows() const { return m_rows; }
+	std::size_t column_of(std::size_t row) const { return m_row_column[row]; }
+	double score(std::size_t row, std::size_t column) const { return m_scores[row * m_columns + column]; }
+	double score(std::size_t row) const { return score(row, column_of(row)); }
+	const std::vector<std::size_t>& assignment() const { return m_row_column; }
+
+	// Every score(row, column) <= row_dual(row) + column_dual(column), with equality where the row is assigned.
+	double row_dual(std::size_t row) const { return -m_row_potential[row + 1]; }
+	double column_dual(std::size_t column) const { return -m_column_potential[column + 1]; }
+
+	double total() const
+	{
+		double result = 0.0;
+		for (std::size_t row = 0u; row < m_rows; ++row)
+		{
+			result += score(row);
+		}
+		return result;
+	}
+
+	// The best total with row and column taken out, at [row * columns + column], for every row and column of a square
+	// matrix. Taking out a row frees its column and taking out a column leaves its row without one, so the rest is
+	// the assignment less those two scores plus the best path of reassignments from that row to that column. By the
+	// duals, with each score's slack below them as its length, paths to one column are found for every row at once,
+	// so all of them take O(n³).
+	std::vector<double> totals_without() const
+	{
+		assert(m_rows == m_columns);
+		const std::size_t n = m_rows;
+		double dual_total = 0.0;
+		std::vector<std::size_t> row_of(n);
+		for (std::size_t row = 0u; row < n; ++row)
+		{
+			dual_total += row_dual(row) + column_dual(row);
+			row_of[column_of(row)] = row;
+		}
+		auto slack = [this](std::size_t row, std::size_t column) {return row_dual(row) + column_dual(column) - score(row, column); };
+
+		std::vector<double> result(n * n);
+		std::vector<double> distance(n);
+		std::vector<char> done(n);
+		for (std::size_t removed = 0u; removed < n; ++removed)
+		{
+			// The shortest path from each row to the removed row's column, through the rows assigned to the others.
+			std::ranges::fill(distance, std::numeric_limits<double>::infinity());
+			std::ranges::fill(done, false);
+			distance[removed] = 0.0;
+			for (std::size_t step = 0u; step < n; ++step)
+			{
+				std::size_t next = n;
+				for (std::size_t row = 0u; row < n; ++row)
+				{
+					if (!done[row] && (next == n || distance[row] < distance[next])) next = row;
+				}
+				done[next] = true;
+				for (std::size_t row = 0u; row < n; ++row)
+				{
+					if (!done[row]) distance[row] = std::min(distance[row], distance[next] + slack(row, column_of(next)));
+				}
+			}
+			for (std::size_t column = 0u; column < n; ++column)
+			{
+				result[removed * n + column] = dual_total - row_dual(removed) - column_dual(column) - distance[row_of[column]];
+			}
+		}
+		return result;
+	}
+
+	// Replaces one row's scores and restores the optimal assignment.
+	void set_row(std::size_t row, std::span<const double> scores)
+	{
+		// Columns left unassigned on a rectangular matrix must keep a zero potential, which freeing one would break.
+		assert(m_rows == m_columns);
+		assert(scores.size() == m_columns);
+		std::ranges::copy(scores, begin(m_scores) + row * m_columns);
+		m_column_owner[m_row_column[row] + 1] = 0u;
+		m_row_potential[row + 1] = 0.0;
+		augment(row + 1);
+		update_row_columns();
+	}
+
+	// Undoes set_row on a copy of the original solver, in O(n) rather than copying the whole score matrix.
+	void restore_row(const AssignmentSolver& original, std::size_t row)
+	{
+		assert(m_rows == original.m_rows && m_columns == original.m_columns);
+		std::copy_n(begin(original.m_scores) + row * m_columns, m_columns, begin(m_scores) + row * m_columns);
+		m_row_potential = original.m_row_potential;
+		m_column_potential = original.m_column_potential;
+		m_column_owner = original.m_column_owner;
+		m_row_column = original.m_row_column;
+	}
+
+private:
+	std::vector<double> m_scores;
+	std::size_t m_rows = 0u;
+	std::size_t m_columns = 0u;
+
+	// 1-indexed; column 0 is a sentinel. m_column_owner[j] is the row assigned to column j, or 0.
+	std::vector<double> m_row_potential;
+	std::vector<double> m_column_potential;
+	std::vector<std::size_t> m_column_owner;
+	std::vector<std::size_t> m_row_column;
+
+	std::vector<std::size_t> m_way;
+	std::vector<double> m_min_slack;
+	std::vector<char> m_used;
+
+	// Finds a shortest augmenting path from an unassigned row, adjusting potentials as it goes.
+	void augment(std::size_t row)
+	{
+		constexpr double INF = std::numeric_limits<double>::infinity();
+		m_way.assign(m_columns + 1, 0u);
+		m_min_slack.assign(m_columns + 1, INF);
+		m_used.assign(m_columns + 1, false);
+
+		m_column_owner[0] = row;
+		std::size_t j0 = 0u;
+		do
+		{
+			m_used[j0] = true;
+			const std::size_t i0 = m_column_owner[j0];
+			double delta = INF;
+			std::size_t j1 = 0u;
+			for (std::size_t j = 1u; j <= m_columns; ++j)
+			{
+				if (m_used[j]) continue;
+				const double cur = -m_scores[(i0 - 1) * m_columns + (j - 1)] - m_row_potential[i0] - m_column_potential[j];
+				if (cur < m_min_slack[j])
+				{
+					m_min_slack[j] = cur;
+					m_way[j] = j0;
+				}
+				if (m_min_slack[j] < delta)
+				{
+					delta = m_min_slack[j];
+					j1 = j;
+				}
+			}
+			for (std::size_t j = 0u; j <= m_columns; ++j)
+			{
+				if (m_used[j])
+				{
+					m_row_potential[m_column_owner[j]] += delta;
+					m_column_potential[j] -= delta;
+				}
+				else
+				{
+					m_min_slack[j] -= delta;
+				}
+			}
+			j0 = j1;
+		} while (m_column_owner[j0] != 0u);
+
+		do
+		{
+			const std::size_t j1 = m_way[j0];
+			m_column_owner[j0] = m_column_owner[j1];
+			j0 = j1;
+		} while (j0 != 0u);
+	}
+
+	void update_row_columns()
+	{
+		for (std::size_t j = 1u; j <= m_columns; ++j)
+		{
+			if (m_column_owner[j] != 0u)
+			{
+				m_row_column[m_column_owner[j] - 1] = j - 1;
+			}
+		}
+	}
+};
+
+// Returns the column assigned to each row. See AssignmentSolver.
+std::vector<std::size_t> solve_assignment(std::span<const double> scores, std::size_t rows, std::size_t columns)
+{
+	const AssignmentSolver solver{ std::vector<double>(begin(scores), end(scores)), rows, columns };
+	return solver.assignment();
+}
+
+SideArrangement find_best_positions_hungarian(std::span<const PickTempData> players, const ScoreMatrix& matrix, Unit unit)
+{
+	const std::size_t n = players.size();
+	assert(n == matrix.lineup_size);
+
+	std::vector<double> scores;
+	scores.reserve(n * n);
+	for (const PickTempData& data : players)
+	{
+		std::ranges::copy(matrix.row(unit, data.id), std::back_inserter(scores));
+	}
+
+	const std::vector<std::size_t> assignment = solve_assignment(scores, n, n);
+
+	SideArrangement result;
+	result.first.reserve(n);
+	for (std::size_t row = 0u; row < n; ++row)
+	{
+		PositionDescription pd;
+		pd.slot = static_cast<std::uint32_t>(assignment[row]);
+		pd.score = scores[row * n + assignment[row]];
+		result.second += pd.score;
+		result.first.push_back(pd);
+	}
+	return result;
+}
+
+// The best positions on one side for exactly lineup_size players.
+SideArrangement find_best_positions(std::span<const PickTempData> players, const ScoreMatrix& matrix, const PositionRequirements& requirements,
+	Unit unit, AssignmentMethod method)
+{
+	Profile::count(ProfileCounter::FindBestPositionsCalls);
+	switch (method)
+	{
+	case AssignmentMethod::Exhaustive:
+		return find_best_positions_exhaustive(players, matrix, unit, unit == Unit::Offence ? requirements.attacking_ids : requirements.defensive_ids);
+	case AssignmentMethod::Hungarian:
+	default:
+		return find_best_positions_hungarian(players, matrix, unit);
+	}
+}
+
+// The best offence and defence arrangements of exactly these starters.
+std::pair<std::vector<StartingPositionDescription>, double> arrange_starters(std::span<const PickTempData> starters, const ScoreMatrix& matrix, const PositionRequirements& requirements, const PickOptions& options)
+{
+	const std::size_t target_size = starters.size();
+	const auto [attacking_lineup, attacking_score] = find_best_positions(starters, matrix, requirements, Unit::Offence, options.assignment);
+	const auto [defending_lineup, defending_score] = find_best_positions(starters, matrix, requirements, Unit::Defence, options.assignment);
+	const double total_score = attacking_score + defending_score;
+
+	std::vector<StartingPositionDescription> result;
+	result.reserve(target_size);
+	for (std::size_t i = 0u; i < target_size; ++i)
+	{
+		StartingPositionDescription r;
+		r.player = starters[i].id;
+		r.offence = attacking_lineup[i];
+		r.defence = defending_lineup[i];
+		r.score = r.offence.score + r.defence.score;
+		result.push_back(r);
+	}
+	return std::pair{ result, total_score };
+}
+
+std::pair<std::vector<StartingPositionDescription>, double> get_initial_try_starters(std::span<const PickTempData> data, const ScoreMatrix& matrix, const PositionRequirements& requirements, const PickOptions& options)
+{
+	const PhaseTimer timer{ ProfilePhase::InitialSeed };
+	Log::info("Picking initial starting line up...\n");
+	const std::size_t target_size = requirements.attacking.size();
+	assert(requirements.defensive.size() == target_size);
+	assert(data.size() >= target_size);
+	return arrange_starters(data.first(target_size), matrix, requirements, options);
+}
+
+// The best offence and defence arrangements of the current starters. Row i of each solver is picks[i].
+struct LineupAssignment
+{
+	AssignmentSolver offence, defence;
+};
+
+LineupAssignment make_lineup_assignment(const std::vector<StartingPositionDescription>& picks, const ScoreMatrix& matrix)
+{
+	auto make_solver = [&picks, &matrix](Unit unit)
+		{
+			std::vector<double> scores;
+			scores.reserve(picks.size() * matrix.lineup_size);
+			for (const StartingPositionDescription& spd : picks)
+			{
+				std::ranges::copy(matrix.row(unit, spd.player), std::back_inserter(scores));
+			}
+			return AssignmentSolver{ std::move(scores), picks.size(), matrix.lineup_size };
+		};
+	return LineupAssignment{ make_solver(Unit::Offence), make_solver(Unit::Defence) };
+}
+
+// A player's best score on one side less that position's column dual. Replacing the starter in row i with the
+// player can improve that side by at most this less row_dual(i), since the other starters can do no better than
+// their duals.
+double dual_margin(const AssignmentSolver& solver, std::span<const double> scores)
+{
+	assert(solver.rows() == scores.size());
+	double result = std::numeric_limits<double>::lowest();
+	for (std::size_t column = 0u; column < scores.size(); ++column)
+	{
+		result = std::max(result, scores[column] - solver.column_dual(column));
+	}
+	return result;
+}
+
+// How much swapping player in for any one starter could improve the line up, at most. See dual_margin.
+double swap_gain_bound(const LineupAssignment& current, const ScoreMatrix& matrix, const PickTempData& player)
+{
+	double cheapest_starter = std::numeric_limits<double>::max();
+	for (std::size_t row = 0u; row < current.offence.rows(); ++row)
+	{
+		cheapest_starter = std::min(cheapest_starter, current.offence.row_dual(row) + current.defence.row_dual(row));
+	}
+	return dual_margin(current.offence, matrix.row(Unit::Offence, player.id))
+		+ dual_margin(current.defence, matrix.row(Unit::Defence, player.id)) - cheapest_starter;
+}
+
+// Players a line up must start and players it may not, indexed by ID. Empty for no constraint.
+struct LineupConstraints
+{
+	std::vector<char> forced, excluded;
+
+	bool is_forced(std::uint32_t id) const { return !forced.empty() && forced[id]; }
+	bool is_excluded(std::uint32_t id) const { return !excluded.empty() && excluded[id]; }
+};
+
+struct SwapResult
+{
+	std::vector<StartingPositionDescription> starters;
+	std::uint32_t swapped_out = 0u; // ID
+	double delta = 0.0;
+};
+
+// The starters with the one in row i replaced by the player, re-arranged on both sides, and their new total. With
+// the Hungarian method only that row of the current arrangements is solved again, on scratch: a copy of current
+// that is restored before returning.
+std::pair<std::vector<StartingPositionDescription>, double> replace_starter(const std::vector<StartingPositionDescription>& picks, const LineupAssignment& current,
+	LineupAssignment& scratch, const ScoreMatrix& matrix, const PositionRequirements& requirements, const PickOptions& options, std::size_t i, const PickTempData& player)
+{
+	std::vector<StartingPositionDescription> trial = picks;
+	trial[i].player = player.id;
+	if (options.assignment == AssignmentMethod::Exhaustive)
+	{
+		std::vector<PickTempData> data_copy;
+		data_copy.reserve(trial.size());
+		std::ranges::transform(trial, std::back_inserter(data_copy), [](const StartingPositionDescription& spd) {return PickTempData{ spd.player }; });
+		const std::vector<PositionDescription> offence = find_best_positions(data_copy, matrix, requirements, Unit::Offence, options.assignment).first;
+		const std::vector<PositionDescription> defence = find_best_positions(data_copy, matrix, requirements, Unit::Defence, options.assignment).first;
+		for (std::size_t row = 0u; row < trial.size(); ++row)
+		{
+			trial[row].offence = offence[row];
+			trial[row].defence = defence[row];
+		}
+	}
+	else
+	{
+		AssignmentSolver& offence = scratch.offence;
+		AssignmentSolver& defence = scratch.defence;
+		offence.set_row(i, matrix.row(Unit::Offence, player.id));
+		defence.set_row(i, matrix.row(Unit::Defence, player.id));
+		for (std::size_t row = 0u; row < trial.size(); ++row)
+		{
+			trial[row].offence = PositionDescription{ static_cast<std::uint32_t>(offence.column_of(row)), offence.score(row) };
+			trial[row].defence = PositionDescription{ static_cast<std::uint32_t>(defence.column_of(row)), defence.score(row) };
+		}
+		offence.restore_row(current.offence, i);
+		defence.restore_row(current.defence, i);
+	}
+
+	double new_score = 0.0;
+	for (StartingPositionDescription& pick : trial)
+	{
+		pick.score = pick.offence.score + pick.defence.score;
+		new_score += pick.score;
+	}
+	return std::pair{ std::move(trial), new_score };
+}
+
+// Tries the player in place of each starter, re-arranging both offence and defence, and returns the best improvement.
+// Forced starters are never swapped out and excluded players never swapped in. Scratch is as for replace_starter.
+std::optional<SwapResult> try_swapping_in_player(const std::vector<StartingPositionDescription>& picks, const LineupAssignment& current, LineupAssignment& scratch, const ScoreMatrix& matrix, const PositionRequirements& requirements, const PickOptions& options, const LineupConstraints& constraints, const PickTempData& player)
+{
+	if (constraints.is_excluded(player.id) || std::ranges::find(picks, player.id, &StartingPositionDescription::player) != end(picks))
+	{
+		return std::nullopt;
+	}
+
+	const double old_score = current.offence.total() + current.defence.total();
+	const double margin = dual_margin(current.offence, matrix.row(Unit::Offence, player.id)) + dual_margin(current.defence, matrix.row(Unit::Defence, player.id));
+	const double tolerance = 1e-9 * (1.0 + std::abs(old_score));
+
+	std::optional<SwapResult> best_improvement;
+	std::uint64_t num_tried = 0u;
+
+	for (std::size_t i = 0u; i < picks.size(); ++i)
+	{
+		if (constraints.is_forced(picks[i].player)) continue;
+		if (margin - current.offence.row_dual(i) - current.defence.row_dual(i) < -tolerance) continue;
+		++num_tried;
+
+		auto [trial, new_score] = replace_starter(picks, current, scratch, matrix, requirements, options, i, player);
+		// Gains within rounding are not real: taking them could swap back and forth between equal line ups.
+		const double change_delta = new_score - old_score;
+		if (change_delta > (best_improvement.has_value() ? best_improvement->delta : tolerance))
+		{
+			best_improvement = SwapResult{ std::move(trial), picks[i].player, change_delta };
+		}
+	}
+	Profile::count(ProfileCounter::SwapsTried, num_tried);
+	return best_improvement;
+}
+
+// Simulated annealing over which players start, run until the deadline. Positions are always the best
+// arrangement of the current starters, so exchanging positions between starters is never a separate move:
+// a move swaps one bench player for one starter and re-solves that row of each side incrementally.
+// Returns the best line up seen.
+std::vector<StartingPositionDescription> anneal_team(std::span<const PickTempData> data, const ScoreMatrix& matrix,
+	std::vector<StartingPositionDescription> starters, std::chrono::steady_clock::time_point deadline)
+{
+	const PhaseTimer timer{ ProfilePhase::Annealing };
+	using Clock = std::chrono::steady_clock;
+	const std::size_t lineup_size = starters.size();
+	if (data.size() <= lineup_size) return starters;
+
+	const Clock::time_point start = Clock::now();
+
+	std::vector<std::size_t> lineup;
+	std::vector<char> in_lineup(data.size(), false);
+	for (const StartingPositionDescription& spd : starters)
+	{
+		const auto it = std::ranges::find(data, spd.player, &PickTempData::id);
+		assert(it != end(data));
+		lineup.push_back(static_cast<std::size_t>(std::distance(begin(data), it)));
+		in_lineup[lineup.back()] = true;
+	}
+
+	LineupAssignment current = make_lineup_assignment(starters, matrix);
+	double current_score = current.offence.total() + current.defence.total();
+	double best_score = current_score;
+
+	// Candidates are drawn biased towards the top of data, which is sorted by max_score.
+	std::mt19937_64 rng{ 0x5eed };
+	std::uniform_real_distribution<double> unit{ 0.0, 1.0 };
+	auto try_move = [&](std::size_t row, std::size_t candidate)
+		{
+			current.offence.set_row(row, matrix.row(Unit::Offence, data[candidate].id));
+			current.defence.set_row(row, matrix.row(Unit::Defence, data[candidate].id));
+			return current.offence.total() + current.defence.total() - current_score;
+		};
+	auto undo_move = [&](std::size_t row)
+		{
+			current.offence.set_row(row, matrix.row(Unit::Offence, data[lineup[row]].id));
+			current.defence.set_row(row, matrix.row(Unit::Defence, data[lineup[row]].id));
+		};
+	auto random_move = [&]()
+		{
+			const std::size_t row = std::uniform_int_distribution<std::size_t>{ 0u, lineup_size - 1u }(rng);
+			std::size_t candidate = 0u;
+			do
+			{
+				const double u = unit(rng);
+				candidate = std::min(data.size() - 1u, static_cast<std::size_t>(u * u * static_cast<double>(data.size())));
+			} while (in_lineup[candidate]);
+			return std::pair{ row, candidate };
+		};
+
+	// Start hot enough to accept a typical worsening move about half the time, and cool geometrically to a
+	// thousandth of that by the deadline.
+	double typical_loss = 0.0;
+	int losses = 0;
+	for (int i = 0; i < 100; ++i)
+	{
+		const auto [row, candidate] = random_move();
+		const double delta = try_move(row, candidate);
+		undo_move(row);
+		if (delta < 0.0)
+		{
+			typical_loss += -delta;
+			++losses;
+		}
+	}
+	const double start_temperature = losses > 0 ? typical_loss / losses / std::log(2.0) : 1.0;
+	const double end_temperature = start_temperature * 0.001;
+	const double total_time = std::max(1.0, std::chrono::duration<double, std::milli>(deadline - start).count());
+
+	double temperature = start_temperature;
+	std::size_t iterations = 0u;
+	std::size_t accepted = 0u;
+	// Progress is reported at every tenth of the time.
+	int reports = 0;
+	while (true)
+	{
+		if ((iterations % 64u) == 0u)
+		{
+			const Clock::time_point now = Clock::now();
+			if (now >= deadline) break;
+			const double progress = std::chrono::duration<double, std::milli>(now - start).count() / total_time;
+			temperature = start_temperature * std::pow(end_temperature / start_temperature, progress);
+			if (progress * 10.0 >= reports + 1)
+			{
+				reports = static_cast<int>(progress * 10.0);
+				Log::info("    {:.0f}%: temperature {:.3g}, current {:.2f}, best {:.2f} after {} moves.\n", progress * 100.0, temperature, current_score, best_score, iterations);
+			}
+		}
+		++iterations;
+
+		const auto [row, candidate] = random_move();
+		const double delta = try_move(row, candidate);
+		if (delta < 0.0 && unit(rng) >= std::exp(delta / temperature))
+		{
+			undo_move(row);
+			continue;
+		}
+
+		++accepted;
+		in_lineup[lineup[row]] = false;
+		in_lineup[candidate] = true;
+		lineup[row] = candidate;
+		current_score += delta;
+		if (current_score > best_score + 0.000001)
+		{
+			best_score = current_score;
+			for (std::size_t r = 0u; r < lineup_size; ++r)
+			{
+				StartingPositionDescription& spd = starters[r];
+				spd.player = data[lineup[r]].id;
+				spd.offence = PositionDescription{ static_cast<std::uint32_t>(current.offence.column_of(r)), current.offence.score(r) };
+				spd.defence = PositionDescription{ static_cast<std::uint32_t>(current.defence.column_of(r)), current.defence.score(r) };
+				spd.score = spd.offence.score + spd.defence.score;
+			}
+			const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start);
+			Log::trace("    {} ms: improved to {:.2f} after {} moves.\n", elapsed.count(), best_score, iterations);
+		}
+	}
+	Log::info("    Annealing finished: {} moves tried, {} accepted, best {:.2f}.\n", iterations, accepted, best_score);
+	Profile::count(ProfileCounter::AnnealMovesTried, iterations);
+	Profile::count(ProfileCounter::AnnealMovesAccepted, accepted);
+	return starters;
+}
+
+// Branch-and-bound search over which players start, solving their offence and defence positions together.
+// Players are decided in order of max_score. Each node is bounded first by the max_scores of its players,
+// then by the best offence and defence arrangements with the chosen players forced in. Those only need the
+// top few undecided players at each position, so the bound stays cheap on large rosters.
+// Arranging offence and defence separately lets them use different players. To tighten that, each player gets
+// a multiplier added to their offence scores and taken from their defence scores. A real line up uses the same
+// players on both sides so the multipliers cancel, and any choice of them gives a valid bound. They are tuned at
+// the root by subgradient descent.
+// For a draft the slots are several teams' in turn, scored by each team's weight, and each player chosen is also
+// given a team. A player may then only fill their own team's slots, and their multipliers are per team, so the
+// relaxation's offence and defence also mostly agree on who plays for whom.
+class ExactSearch
+{
+public:
+	struct Result
+	{
+		std::vector<StartingPositionDescription> starters;
+		double score = 0.0;
+		double upper_bound = 0.0;
+		std::size_t nodes = 0u;
+		bool complete = false;
+	};
+
+	static constexpr std::size_t MAX_TEAMS = 16u;
+
+	// team_sizes splits the slots into teams in turn; by default they are all one team's. Each team's scores are
+	// multiplied by its entry in team_weights, if given, as they are copied in. data must be sorted by max_score,
+	// which must be at least the player's best weighted score for any one team.
+	ExactSearch(std::span<const PickTempData> data, const ScoreMatrix& matrix, std::span<const std::size_t> team_sizes = {},
+		std::span<const double> team_weights = {})
+		: m_data{ data }
+		, m_lineup_size{ matrix.lineup_size }
+		, m_num_teams{ std::max<std::size_t>(1u, team_sizes.size()) }
+		, m_offence{ make_side(data, matrix, Unit::Offence, team_sizes, team_weights) }
+		, m_defence{ make_side(data, matrix, Unit::Defence, team_sizes, team_weights) }
+	{
+		m_team_size.assign(begin(team_sizes), end(team_sizes));
+		if (m_team_size.empty()) m_team_size.push_back(m_lineup_size);
+		for (std::size_t team = 0u; team < m_num_teams; ++team) m_slot_team.insert(end(m_slot_team), m_team_size[team], team);
+		assert(m_slot_team.size() == m_lineup_size);
+
+		m_max_score_prefix.reserve(data.size() + 1);
+		m_max_score_prefix.push_back(0.0);
+		for (const PickTempData& ptd : data)
+		{
+			m_max_score_prefix.push_back(m_max_score_prefix.back() + ptd.max_score);
+		}
+		m_team_max.reserve(data.size() * m_num_teams);
+		for (std::size_t player = 0u; player < data.size(); ++player)
+		{
+			if (m_num_teams == 1u)
+			{
+				m_team_max.push_back(data[player].max_score);
+				continue;
+			}
+			for (std::size_t team = 0u, first = 0u; team < m_num_teams; first += m_team_size[team++])
+			{
+				const auto in_team = [first, this, team](const Side& side, std::size_t p)
+					{
+						return std::ranges::max(std::span{ side.scores }.subspan(p * m_lineup_size + first, m_team_size[team]));
+					};
+				m_team_max.push_back(in_team(m_offence, player) + in_team(m_defence, player));
+			}
+		}
+		m_candidate_stamp.resize(data.size(), 0u);
+		m_multipliers.resize(data.size() * m_num_teams, 0.0);
+		m_excluded.resize(data.size(), false);
+		m_forced_from.resize(data.size() + 1, 0u);
+		m_team_filled.resize(m_num_teams, 0u);
+	}
+
+	// Only line ups that start every forced player and no excluded one are searched. The bounds still count the
+	// excluded players, which loosens them but keeps them valid.
+	void constrain(const LineupConstraints& constraints)
+	{
+		for (std::size_t i = m_data.size(); i-- > 0u;)
+		{
+			m_excluded[i] = constraints.is_excluded(m_data[i].id);
+			m_forced_from[i] = m_forced_from[i + 1] + (constraints.is_forced(m_data[i].id) ? 1u : 0u);
+		}
+	}
+
+	Result run(const std::vector<StartingPositionDescription>& incumbent, std::optional<std::chrono::steady_clock::time_point> deadline)
+	{
+		const PhaseTimer timer{ ProfilePhase::ExactSearch };
+		m_deadline = deadline;
+		m_best_lineup.clear();
+		m_best_teams.clear();
+		for (const StartingPositionDescription& spd : incumbent)
+		{
+			const auto it = std::ranges::find(m_data, spd.player, &PickTempData::id);
+			assert(it != end(m_data));
+			m_best_lineup.push_back(static_cast<std::size_t>(std::distance(begin(m_data), it)));
+			m_best_teams.push_back(m_slot_team[spd.offence.slot]);
+		}
+		m_best_score = std::transform_reduce(begin(incumbent), end(incumbent), 0.0, std::plus<double>{},
+			[](const StartingPositionDescription& spd) {return spd.score; });
+		m_open_bound = std::numeric_limits<double>::lowest();
+		m_nodes = 0u;
+		m_stopped = false;
+
+		const double root_bound = std::min(m_max_score_prefix[std::min(m_lineup_size, m_data.size())], tune_multipliers());
+		std::vector<std::size_t> chosen;
+		chosen.reserve(m_lineup_size);
+		m_chosen_teams.clear();
+		std::ranges::fill(m_team_filled, 0u);
+		explore(chosen, 0u, 0.0, root_bound);
+
+		Result result;
+		result.score = m_best_score;
+		result.upper_bound = std::max(m_best_score, m_open_bound);
+		result.nodes = m_nodes;
+		Profile::count(ProfileCounter::ExactNodes, m_nodes);
+		result.complete = !m_stopped;
+
+		const Assignment offence = assign(m_offence, m_best_lineup, m_best_lineup.size(), false, m_best_teams);
+		const Assignment defence = assign(m_defence, m_best_lineup, m_best_lineup.size(), false, m_best_teams);
+		for (std::size_t i = 0u; i < m_best_lineup.size(); ++i)
+		{
+			const std::size_t player = m_best_lineup[i];
+			StartingPositionDescription spd;
+			spd.player = m_data[player].id;
+			spd.offence.slot = static_cast<std::uint32_t>(offence.slot_of_column[i]);
+			spd.offence.score = m_offence.score(player, offence.slot_of_column[i]);
+			spd.defence.slot = static_cast<std::uint32_t>(defence.slot_of_column[i]);
+			spd.defence.score = m_defence.score(player, defence.slot_of_column[i]);
+			spd.score = spd.offence.score + spd.defence.score;
+			result.starters.push_back(spd);
+		}
+		return result;
+	}
+
+private:
+	static constexpr double EPSILON = 0.000001;
+	static constexpr int MULTIPLIER_ITERATIONS = 300;
+
+	struct Side
+	{
+		std::size_t num_slots = 0u;
+		std::vector<double> scores; // scores[player * num_slots + slot]
+		std::vector<double> bound_scores; // As scores, adjusted by the multipliers.
+		std::vector<std::vector<std::size_t>> ranking; // For each slot, players from best to worst bound_score.
+
+		double score(std::size_t player, std::size_t slot) const { return scores[player * num_slots + slot]; }
+		double bound_score(std::size_t player, std::size_t slot) const { return bound_scores[player * num_slots + slot]; }
+	};
+
+	struct Assignment
+	{
+		double score = 0.0;
+		std::vector<std::size_t> slot_of_column;
+	};
+
+	std::span<const PickTempData> m_data;
+	std::size_t m_lineup_size = 0u;
+	std::size_t m_num_teams = 1u;
+	std::vector<std::size_t> m_team_size;
+	std::vector<std::size_t> m_slot_team;
+	Side m_offence, m_defence;
+	std::vector<double> m_max_score_prefix;
+	std::vector<double> m_team_max; // m_team_max[player * m_num_teams + team]: their best score for that team.
+	std::vector<double> m_multipliers; // By player and team, as m_team_max.
+	std::vector<char> m_excluded;
+	std::vector<std::size_t> m_forced_from; // The number of forced players from each index on.
+
+	std::vector<std::size_t> m_columns;
+	std::vector<double> m_matrix;
+	std::vector<std::uint32_t> m_candidate_stamp;
+	std::uint32_t m_stamp = 0u;
+
+	std::optional<std::chrono::steady_clock::time_point> m_deadline;
+	std::vector<std::size_t> m_chosen_teams; // The team of each chosen player.
+	std::vector<std::size_t> m_team_filled;
+	std::vector<std::size_t> m_best_lineup;
+	std::vector<std::size_t> m_best_teams;
+	double m_best_score = 0.0;
+	double m_open_bound = 0.0;
+	std::size_t m_nodes = 0u;
+	bool m_stopped = false;
+
+	static Side make_side(std::span<const PickTempData> data, const ScoreMatrix& matrix, Unit unit,
+		std::span<const std::size_t> team_sizes, std::span<const double> team_weights)
+	{
+		Side side;
+		side.num_slots = matrix.lineup_size;
+		side.scores.reserve(data.size() * side.num_slots);
+		for (const PickTempData& ptd : data)
+		{
+			std::ranges::copy(matrix.row(unit, ptd.id), std::back_inserter(side.scores));
+		}
+		if (!team_weights.empty())
+		{
+			assert(team_weights.size() == team_sizes.size());
+			std::vector<double> slot_weights;
+			for (std::size_t team = 0u; team < team_sizes.size(); ++team) slot_weights.insert(end(slot_weights), team_sizes[team], team_weights[team]);
+			for (std::size_t i = 0u; i < side.scores.size(); ++i) side.scores[i] *= slot_weights[i % side.num_slots];
+		}
+		side.bound_scores = side.scores;
+		side.ranking.resize(side.num_slots);
+		return side;
+	}
+
+	void apply_multipliers()
+	{
+		const std::size_t num_slots = m_lineup_size;
+		for (std::size_t player = 0u; player < m_data.size(); ++player)
+		{
+			for (std::size_t slot = 0u; slot < num_slots; ++slot)
+			{
+				const std::size_t i = player * num_slots + slot;
+				const double multiplier = m_multipliers[player * m_num_teams + m_slot_team[slot]];
+				m_offence.bound_scores[i] = m_offence.scores[i] + multiplier;
+				m_defence.bound_scores[i] = m_defence.scores[i] - multiplier;
+			}
+		}
+	}
+
+	void rank_players(Side& side)
+	{
+		for (std::size_t slot = 0u; slot < side.num_slots; ++slot)
+		{
+			std::vector<std::size_t>& ranking = side.ranking[slot];
+			ranking.resize(m_data.size());
+			std::iota(begin(ranking), end(ranking), std::size_t{ 0 });
+			std::ranges::stable_sort(ranking, std::greater<double>{}, [&side, slot](std::size_t player) {return side.bound_score(player, slot); });
+		}
+	}
+
+	// Finds multipliers that make the unforced bound as low as possible, then ranks players by the adjusted scores.
+	// Line ups found along the way may improve the incumbent. Returns the root bound.
+	double tune_multipliers()
+	{
+		std::vector<double> best_multipliers = m_multipliers;
+		double best_bound = std::numeric_limits<double>::infinity();
+		double step_scale = 2.0;
+		int since_improved = 0;
+		std::vector<std::size_t> scratch(m_data.size());
+		std::vector<int> used(m_data.size() * m_num_teams, 0);
+
+		for (int iteration = 0; iteration < MULTIPLIER_ITERATIONS; ++iteration)
+		{
+			apply_multipliers();
+
+			// Without forced players only the top lineup_size players at each slot can matter.
+			double bound = 0.0;
+			for (const Side* side : { &m_offence, &m_defence })
+			{
+				m_columns.clear();
+				++m_stamp;
+				for (std::size_t slot = 0u; slot < m_lineup_size; ++slot)
+				{
+					std::iota(begin(scratch), end(scratch), std::size_t{ 0 });
+					const auto nth = begin(scratch) + std::min(m_lineup_size, scratch.size());
+					std::nth_element(begin(scratch), nth - 1, end(scratch), [side, slot](std::size_t l, std::size_t r) {return side->bound_score(l, slot) > side->bound_score(r, slot); });
+					for (auto it = begin(scratch); it != nth; ++it)
+					{
+						add_candidate(*it);
+					}
+				}
+				const Assignment assignment = assign(*side, m_columns, 0u, true, {});
+				bound += assignment.score;
+				const int direction = side == &m_offence ? 1 : -1;
+				std::vector<std::size_t> lineup, teams;
+				for (std::size_t col = 0u; col < m_columns.size(); ++col)
+				{
+					if (assignment.slot_of_column[col] < m_lineup_size)
+					{
+						const std::size_t team = m_slot_team[assignment.slot_of_column[col]];
+						used[m_columns[col] * m_num_teams + team] += direction;
+						lineup.push_back(m_columns[col]);
+						teams.push_back(team);
+					}
+				}
+				try_lineup(lineup, teams);
+			}
+
+			if (bound < best_bound - EPSILON)
+			{
+				best_bound = bound;
+				best_multipliers = m_multipliers;
+				since_improved = 0;
+			}
+			else if (++since_improved >= 5)
+			{
+				step_scale /= 2.0;
+				since_improved = 0;
+			}
+
+			const double norm = std::transform_reduce(begin(used), end(used), 0.0, std::plus<double>{}, [](int u) {return static_cast<double>(u * u); });
+			if (norm == 0.0 || bound <= m_best_score + EPSILON || step_scale < 0.001)
+			{
+				break;
+			}
+			const double step = step_scale * (bound - m_best_score) / norm;
+			for (std::size_t i = 0u; i < used.size(); ++i)
+			{
+				m_multipliers[i] -= step * used[i];
+				used[i] = 0;
+			}
+		}
+
+		m_multipliers = std::move(best_multipliers);
+		apply_multipliers();
+		rank_players(m_offence);
+		rank_players(m_defence);
+		return best_bound;
+	}
+
+	// The players one side of the relaxation picked, each in the team of the slot they filled, form a real line up,
+	// and often a good one, if it meets the constraints.
+	void try_lineup(const std::vector<std::size_t>& lineup, const std::vector<std::size_t>& teams)
+	{
+		const std::size_t num_forced = std::ranges::count_if(lineup, [this](std::size_t player) {return m_forced_from[player] != m_forced_from[player + 1]; });
+		if (num_forced != m_forced_from.front() || std::ranges::any_of(lineup, [this](std::size_t player) {return m_excluded[player] != 0; })) return;
+		const double score = assign(m_offence, lineup, lineup.size(), false, teams).score + assign(m_defence, lineup, lineup.size(), false, teams).score;
+		if (score > m_best_score + EPSILON)
+		{
+			m_best_score = score;
+			m_best_lineup = lineup;
+			m_best_teams = teams;
+		}
+	}
+
+	void add_candidate(std::size_t player)
+	{
+		if (m_candidate_stamp[player] != m_stamp)
+		{
+			m_candidate_stamp[player] = m_stamp;
+			m_columns.push_back(player);
+		}
+	}
+
+	// Best arrangement of this side's slots over the first num_forced columns (which must all be used, each in a
+	// slot of their team in forced_teams) and the rest of the columns. With every column forced this is the exact
+	// score for that line up.
+	Assignment assign(const Side& side, const std::vector<std::size_t>& columns, std::size_t num_forced, bool use_bound_scores, std::span<const std::size_t> forced_teams)
+	{
+		const std::size_t num_slots = side.num_slots;
+		const std::vector<double>& scores = use_bound_scores ? side.bound_scores : side.scores;
+		double largest = 1.0;
+		for (std::size_t col = 0u; col < columns.size(); ++col)
+		{
+			for (std::size_t slot = 0u; slot < num_slots; ++slot)
+			{
+				largest = std::max(largest, std::abs(scores[columns[col] * num_slots + slot]));
+			}
+		}
+		const double forced_bonus = 4.0 * largest * static_cast<double>(num_slots) + 1.0;
+
+		m_matrix.resize(num_slots * columns.size());
+		for (std::size_t slot = 0u; slot < num_slots; ++slot)
+		{
+			for (std::size_t col = 0u; col < columns.size(); ++col)
+			{
+				const double bonus = col >= num_forced ? 0.0 : m_slot_team[slot] == forced_teams[col] ? forced_bonus : -forced_bonus;
+				m_matrix[slot * columns.size() + col] = scores[columns[col] * num_slots + slot] + bonus;
+			}
+		}
+		const std::vector<std::size_t> column_of_slot = solve_assignment(m_matrix, num_slots, columns.size());
+
+		Assignment result;
+		result.slot_of_column.resize(columns.size(), num_slots);
+		for (std::size_t slot = 0u; slot < num_slots; ++slot)
+		{
+			result.score += scores[columns[column_of_slot[slot]] * num_slots + slot];
+			result.slot_of_column[column_of_slot[slot]] = slot;
+		}
+		return result;
+	}
+
+	// Upper bound on the side's score over every completion of the chosen players from players first_undecided onwards.
+	// Only the best lineup_size undecided players at each slot can matter to an optimal arrangement.
+	double side_bound(const Side& side, const std::vector<std::size_t>& chosen, std::size_t first_undecided)
+	{
+		m_columns = chosen;
+		++m_stamp;
+		for (std::size_t player : chosen)
+		{
+			m_candidate_stamp[player] = m_stamp;
+		}
+		for (const std::vector<std::size_t>& ranking : side.ranking)
+		{
+			std::size_t found = 0u;
+			for (auto it = begin(ranking); it != end(ranking) && found < m_lineup_size; ++it)
+			{
+				if (*it < first_undecided) continue;
+				++found;
+				add_candidate(*it);
+			}
+		}
+		return assign(side, m_columns, chosen.size(), true, m_chosen_teams).score;
+	}
+
+	bool out_of_time()
+	{
+		if (m_stopped) return true;
+		if (m_deadline.has_value() && (m_nodes % 256u) == 0u && std::chrono::steady_clock::now() > m_deadline.value())
+		{
+			m_stopped = true;
+		}
+		return m_stopped;
+	}
+
+	void explore(std::vector<std::size_t>& chosen, std::size_t next, double chosen_max_score, double parent_bound)
+	{
+		if (out_of_time())
+		{
+			m_open_bound = std::max(m_open_bound, parent_bound);
+			return;
+		}
+		++m_nodes;
+
+		const std::size_t needed = m_lineup_size - chosen.size();
+		if (m_forced_from[next] > needed) return;
+		if (needed == 0u)
+		{
+			try_lineup(chosen, m_chosen_teams);
+			return;
+		}
+		if (m_data.size() - next < needed) return;
+
+		// The undecided players are sorted by max_score, so the best completion by that measure is the next few.
+		const double max_score_bound = chosen_max_score + m_max_score_prefix[next + needed] - m_max_score_prefix[next];
+		if (max_score_bound <= m_best_score + EPSILON) return;
+
+		const double bound = std::min(max_score_bound, side_bound(m_offence, chosen, next) + side_bound(m_defence, chosen, next));
+		if (bound <= m_best_score + EPSILON) return;
+
+		if (!m_excluded[next])
+		{
+			// The teams the player scores best for are tried first.
+			std::array<std::size_t, MAX_TEAMS> teams{};
+			std::iota(begin(teams), begin(teams) + m_num_teams, std::size_t{ 0 });
+			const double* team_max = m_team_max.data() + next * m_num_teams;
+			std::stable_sort(begin(teams), begin(teams) + m_num_teams, [team_max](std::size_t a, std::size_t b) {return team_max[a] > team_max[b]; });
+			for (std::size_t i = 0u; i < m_num_teams; ++i)
+			{
+				const std::size_t team = teams[i];
+				if (m_team_filled[team] == m_team_size[team]) continue;
+				chosen.push_back(next);
+				m_chosen_teams.push_back(team);
+				++m_team_filled[team];
+				explore(chosen, next + 1, chosen_max_score + team_max[team], bound);
+				--m_team_filled[team];
+				m_chosen_teams.pop_back();
+				chosen.pop_back();
+			}
+		}
+		if (m_forced_from[next] == m_forced_from[next + 1]) explore(chosen, next + 1, chosen_max_score, bound);
+	}
+};
+
+// Makes the best swap each round until none improves the line up or the deadline passes, and returns the new score.
+// Progress is logged if log_progress is set.
+// Every swap is tried each round and the best one made. Ties go to the player earliest in players so the
+// result does not depend on the number of threads. Players whose dual bound (see swap_gain_bound) shows they cannot
+// improve on the line up are skipped.
+double swap_until_no_gain(const PickData& pick_data, const PositionRequirements& requirements, const PickOptions& options,
+	const LineupConstraints& constraints, bool log_progress, std::vector<StartingPositionDescription>& starters, double best_score,
+	std::optional<std::chrono::steady_clock::time_point> deadline)
+{
+	const PhaseTimer timer{ ProfilePhase::SwapSearch };
+	auto out_of_time = [&deadline]() {return deadline.has_value() && std::chrono::steady_clock::now() >= deadline.value(); };
+	const std::vector<PickTempData>& players = pick_data.players;
+	const ScoreMatrix& matrix = pick_data.scores;
+	ThreadPool pool{ options.threads };
+	std::vector<std::optional<SwapResult>> swaps(players.size());
+	bool has_made_change = true;
+	int round = 0;
+	while (has_made_change && !out_of_time())
+	{
+		has_made_change = false;
+		Profile::count(ProfileCounter::SwapRounds);
+		const LineupAssignment current = make_lineup_assignment(starters, matrix);
+		const double tolerance = 1e-9 * (1.0 + std::abs(best_score));
+		pool.parallel_chunks(players.size(), [&](std::size_t first, std::size_t last)
+			{
+				LineupAssignment scratch = current;
+				for (std::size_t i = first; i < last; ++i)
+				{
+					swaps[i] = std::nullopt;
+					if (out_of_time()) continue;
+					if (swap_gain_bound(current, matrix, players[i]) > -tolerance)
+					{
+						swaps[i] = try_swapping_in_player(starters, current, scratch, matrix, requirements, options, constraints, players[i]);
+					}
+					else
+					{
+						Profile::count(ProfileCounter::SwapCandidatesSkipped);
+					}
+				}
+			});
+
+		std::optional<std::size_t> best_swap;
+		for (std::size_t i = 0u; i < swaps.size(); ++i)
+		{
+			if (swaps[i].has_value() && (!best_swap.has_value() || swaps[i]->delta > swaps[best_swap.value()]->delta))
+			{
+				best_swap = i;
+			}
+		}
+		if (log_progress) Log::info("{}: tried {} players as starters.\n", round++, players.size());
+		if (best_swap.has_value())
+		{
+			SwapResult& swap = swaps[best_swap.value()].value();
+			if (log_progress) Log::info("    Swapped in {} replacing {}\n", pick_data.names[players[best_swap.value()].id], pick_data.names[swap.swapped_out]);
+			const double new_score = std::transform_reduce(begin(swap.starters), end(swap.starters), 0.0, std::plus<double>{},
+				[](const StartingPositionDescription& spd) {return spd.score; });
+			assert(new_score > best_score);
+			best_score = new_score;
+			starters = std::move(swap.starters);
+			has_made_change = true;
+			Profile::count(ProfileCounter::SwapsAccepted);
+		}
+	}
+	return best_score;
+}
+
+// Runs the exact search from the starters, within the options' time limit and the deadline, and returns its line up.
+// With constraints, only line ups that meet them are searched; the starters must meet them too.
+ExactSearch::Result search_exact(const PickData& pick_data, const PickOptions& options, const LineupConstraints& constraints,
+	bool log_progress, const std::vector<StartingPositionDescription>& starters, std::optional<std::chrono::steady_clock::time_point> deadline)
+{
+	std::optional<std::chrono::steady_clock::time_point> exact_deadline = deadline;
+	if (options.exact_time_limit.has_value())
+	{
+		const auto limit = std::chrono::steady_clock::now() + options.exact_time_limit.value();
+		exact_deadline = deadline.has_value() ? std::min(deadline.value(), limit) : limit;
+	}
+	ExactSearch search{ pick_data.players, pick_data.scores };
+	search.constrain(constraints);
+	ExactSearch::Result exact = search.run(starters, exact_deadline);
+	if (log_progress && exact.complete)
+	{
+		Log::info("    Proven optimal after {} nodes.\n", exact.nodes);
+	}
+	else if (log_progress)
+	{
+		const double gap = exact.upper_bound - exact.score;
+		Log::info("    Stopped after {} nodes. Best {:.2f}, upper bound {:.2f}, gap {:.2f} ({:.2f}%).\n",
+			exact.nodes, exact.score, exact.upper_bound, gap, exact.score != 0.0 ? 100.0 * gap / std::abs(exact.score) : 0.0);
+	}
+	return exact;
+}
+
+// Improves the starters by swaps, then by annealing and the exact search if the options ask for them, and returns
+// the result. pick_data.players must be sorted best first.
+std::vector<StartingPositionDescription> improve_team(const PickData& pick_data, const PositionRequirements& requirements, const PickOptions& options,
+	std::vector<StartingPositionDescription> starters, double best_score, std::optional<std::chrono::steady_clock::time_point> deadline)
+{
+	auto out_of_time = [&deadline]() {return deadline.has_value() && std::chrono::steady_clock::now() >= deadline.value(); };
+	best_score = swap_until_no_gain(pick_data, requirements, options, LineupConstraints{}, true, starters, best_score, deadline);
+
+	// With a time budget the rest of it is spent annealing, or half of it if an exact search follows.
+	if (deadline.has_value() && !out_of_time())
+	{
+		Log::info("Annealing...\n");
+		const auto now = std::chrono::steady_clock::now();
+		const auto anneal_deadline = options.exact ? now + (deadline.value() - now) / 2 : deadline.value();
+		starters = anneal_team(pick_data.players, pick_data.scores, std::move(starters), anneal_deadline);
+	}
+
+	if (options.exact)
+	{
+		Log::info("Searching for the best line up...\n");
+		starters = search_exact(pick_data, options, LineupConstraints{}, true, starters, deadline).starters;
+	}
+	return starters;
+}
+
+std::vector<RosterPosition> to_roster_positions(const PickData& pick_data, const PositionRequirements& requirements, const std::vector<StartingPositionDescription>& starters)
+{
+	std::vector<RosterPosition> result;
+	result.reserve(starters.size());
+	std::transform(begin(starters), end(starters), std::back_inserter(result),
+		[&pick_data, &requirements](const StartingPositionDescription& spd)
+		{
+			RosterPosition r;
+			r.name = std::string{ pick_data.names[spd.player] };
+			r.offence = requirements.attacking[spd.offence.slot];
+			r.defence = requirements.defensive[spd.defence.slot];
+			r.offensive_score = spd.offence.score;
+			r.defensive_score = spd.defence.score;
+			r.total_score = spd.score;
+			return r;
+		});
+	return result;
+}
+
+// Picks the starters, sorting and pruning pick_data's players as it goes. pick_data must have an entry for every
+// player, as from to_pick_data.
+std::vector<StartingPositionDescription> pick_starters(PickData& pick_data, const PositionRequirements& requirements, const PickOptions& options)
+{
+	std::optional<std::chrono::steady_clock::time_point> deadline;
+	if (options.time_budget.has_value())
+	{
+		deadline = std::chrono::steady_clock::now() + options.time_budget.value();
+	}
+
+	std::ranges::sort(pick_data.players, {}, [](const PickTempData& ptd) {return ptd.max_score; });
+	std::ranges::reverse(pick_data.players);
+
+	const std::size_t num_players = pick_data.players.size();
+	const std::size_t num_pruned = prune_dominated_players(pick_data.players, pick_data.scores);
+	Log::info("Pruned {} of {} players who are outscored at every position by at least {} others.\n", num_pruned, num_players, requirements.attacking.size());
+
+	auto [starters, best_score] = get_initial_try_starters(pick_data.players, pick_data.scores, requirements, options);
+	return improve_team(pick_data, requirements, options, std::move(starters), best_score, deadline);
+}
+
+// Taking pick_data by value lets callers that keep the scores between picks hand over a copy.
+std::vector<RosterPosition> pick_team(PickData pick_data, const PositionRequirements& requirements, const PickOptions& options)
+{
+	const std::vector<StartingPositionDescription> starters = pick_starters(pick_data, requirements, options);
+	return to_roster_positions(pick_data, requirements, starters);
+}
+
+// As pick_team, but the swaps start from a previous line up rather than the best players by max_score. When only a
+// few players' scores have changed that line up is close to the answer, so few rounds are needed. Players from
+// previous who are no longer in pick_data are replaced by the best of the rest. Pruning only pays for itself
+// before an exact search, so it is skipped otherwise.
+std::vector<RosterPosition> repick_team(PickData pick_data, const PositionRequirements& requirements, std::span<const RosterPosition> previous, const PickOptions& options)
+{
+	std::optional<std::chrono::steady_clock::time_point> deadline;
+	if (options.time_budget.has_value())
+	{
+		deadline = std::chrono::steady_clock::now() + options.time_budget.value();
+	}
+
+	std::ranges::sort(pick_data.players, {}, [](const PickTempData& ptd) {return ptd.max_score; });
+	std::ranges::reverse(pick_data.players);
+	if (options.exact)
+	{
+		const std::size_t num_players = pick_data.players.size();
+		const std::size_t num_pruned = prune_dominated_players(pick_data.players, pick_data.scores);
+		Log::info("Pruned {} of {} players who are outscored at every position by at least {} others.\n", num_pruned, num_players, requirements.attacking.size());
+	}
+
+	const std::size_t lineup_size = requirements.attacking.size();
+	std::vector<PickTempData> lineup;
+	lineup.reserve(lineup_size);
+	auto in_lineup = [&lineup](std::uint32_t id) {return std::ranges::find(lineup, id, &PickTempData::id) != end(lineup); };
+	const std::vector<PickTempData>& players = pick_data.players;
+	for (const RosterPosition& pick : previous)
+	{
+		auto data_it = std::ranges::find(players, std::string_view{ pick.name }, [&pick_data](const PickTempData& ptd) {return pick_data.names[ptd.id]; });
+		if (data_it != end(players) && !in_lineup(data_it->id) && lineup.size() < lineup_size) lineup.push_back(*data_it);
+	}
+	for (auto data_it = begin(players); data_it != end(players) && lineup.size() < lineup_size; ++data_it)
+	{
+		if (!in_lineup(data_it->id)) lineup.push_back(*data_it);
+	}
+
+	auto [starters, best_score] = get_initial_try_starters(lineup, pick_data.scores, requirements, options);
+	return to_roster_positions(pick_data, requirements, improve_team(pick_data, requirements, options, std::move(starters), best_score, deadline));
+}
+
+struct RankedLineup
+{
+	std::vector<RosterPosition> picks;
+	double score = 0.0;
+	// False if the exact search for it ran out of time, so a better line up may be missing from the list.
+	bool proven = true;
+};
+
+// The best num_lineups line ups with different starters, best first, by Murty's method. Once the best line up of a
+// part of the space is listed, the rest of that part is split in turn: for its unforced starters s1, s2, ..., the
+// i-th new part forces s1 to s(i-1) and excludes si. The parts never overlap and together hold every line up not
+// yet listed, so the next best line up is always the best of some part. Each new part's best is found by swaps
+// starting from the listed line up with si replaced, which is usually close, rather than by a fresh pick, and the
+// swaps of the parts split from one line up are run on separate threads. The swaps alone can miss line ups that
+// belong in the list, so a part is proven by the exact search before it is listed, unless its swaps already match
+// the line up it was split from.
+// The time budget covers the whole list: the first line up's annealing gets half of a line up's share of it, and
+// every search after that stops when it runs out, or sooner with --exact-time-limit. The first exact search is
+// usually the longest, and most parts after it are proven by their swaps alone. A search stopped early may return
+// less than its part's best, so that line up is marked unproven and the list is sorted at the end.
+std::vector<RankedLineup> pick_top_lineups(PickData pick_data, const PositionRequirements& requirements, const PickOptions& options, std::size_t num_lineups)
+{
+	std::optional<std::chrono::steady_clock::time_point> deadline;
+	if (options.time_budget.has_value())
+	{
+		deadline = std::chrono::steady_clock::now() + options.time_budget.value();
+	}
+
+	auto out_of_time = [&deadline]() {return deadline.has_value() && std::chrono::steady_clock::now() >= deadline.value(); };
+
+	std::ranges::sort(pick_data.players, {}, [](const PickTempData& ptd) {return ptd.max_score; });
+	std::ranges::reverse(pick_data.players);
+
+	const std::size_t num_players = pick_data.players.size();
+	const std::size_t num_pruned = prune_dominated_players(pick_data.players, pick_data.scores, num_lineups);
+	Log::info("Pruned {} of {} players who are outscored at every position by at least {} others.\n", num_pruned, num_players,
+		requirements.attacking.size() + num_lineups - 1u);
+
+	auto total = [](const std::vector<StartingPositionDescription>& starters)
+		{
+			return std::transform_reduce(begin(starters), end(starters), 0.0, std::plus<double>{},
+				[](const StartingPositionDescription& spd) {return spd.score; });
+		};
+
+	// A part's best is found by swaps and proven by the exact search only once the part reaches the top of the heap.
+	// Until then it is ranked by the score of the line up it was split from, which its best cannot beat, so a part
+	// whose swaps already reach that score needs no exact search.
+	struct Part
+	{
+		std::vector<StartingPositionDescription> starters;
+		double score = 0.0;
+		std::vector<std::uint32_t> forced, excluded;
+		double upper_bound = 0.0;
+		bool proven = false;
+		// Searched, but the exact search stopped before proving score the part's best.
+		bool stopped = false;
+
+		double rank() const { return proven ? score : upper_bound; }
+	};
+	// The first line up has no bound but its exact search, which it gets in turn like any other part.
+	std::optional<std::chrono::steady_clock::time_point> first_deadline = deadline;
+	if (deadline.has_value()) first_deadline = std::chrono::steady_clock::now() + (deadline.value() - std::chrono::steady_clock::now()) / (2u * num_lineups);
+	PickOptions first_options = options;
+	first_options.exact = false;
+	auto initial = get_initial_try_starters(pick_data.players, pick_data.scores, requirements, options);
+	Part first{ improve_team(pick_data, requirements, first_options, std::move(initial.first), initial.second, first_deadline), 0.0, {}, {},
+		std::numeric_limits<double>::infinity(), false };
+	first.score = total(first.starters);
+
+	// Each part is searched on one thread; the parts are spread over options.threads.
+	PickOptions part_options = options;
+	part_options.threads = 1u;
+	std::size_t num_unproven = 0u;
+	const std::size_t lineup_size = requirements.attacking.size();
+	auto constraints_of = [&pick_data](const Part& part)
+		{
+			LineupConstraints constraints{ std::vector<char>(pick_data.names.size(), false), std::vector<char>(pick_data.names.size(), false) };
+			for (std::uint32_t id : part.forced) constraints.forced[id] = true;
+			for (std::uint32_t id : part.excluded) constraints.excluded[id] = true;
+			return constraints;
+		};
+	auto search_part = [&](Part& part)
+		{
+			const LineupConstraints constraints = constraints_of(part);
+
+			// Excluded starters are replaced by the best players left.
+			std::vector<PickTempData> lineup;
+			auto starting = [&lineup](std::uint32_t id) {return std::ranges::find(lineup, id, &PickTempData::id) != end(lineup); };
+			for (const StartingPositionDescription& spd : part.starters)
+			{
+				if (!constraints.is_excluded(spd.player)) lineup.push_back(PickTempData{ spd.player });
+			}
+			for (auto it = begin(pick_data.players); it != end(pick_data.players) && lineup.size() < lineup_size; ++it)
+			{
+				if (!constraints.is_excluded(it->id) && !starting(it->id)) lineup.push_back(*it);
+			}
+			if (lineup.size() < lineup_size)
+			{
+				part.starters.clear();
+				return;
+			}
+
+			auto [starters, score] = arrange_starters(lineup, pick_data.scores, requirements, part_options);
+			score = swap_until_no_gain(pick_data, requirements, part_options, constraints, false, starters, score, deadline);
+			part.starters = std::move(starters);
+			part.score = score;
+			part.proven = score >= part.upper_bound - 1e-9 * (1.0 + std::abs(part.upper_bound));
+		};
+
+	ThreadPool pool{ options.threads };
+	// Of parts ranked the same, a proven one is listed first, so ties do not cost exact searches.
+	auto by_rank = [](const Part& a, const Part& b) {return std::pair{ a.rank(), a.proven } < std::pair{ b.rank(), b.proven }; };
+	std::vector<Part> parts;
+	parts.push_back(std::move(first));
+	std::vector<RankedLineup> result;
+	while (!parts.empty())
+	{
+		std::ranges::pop_heap(parts, by_rank);
+		Part best = std::move(parts.back());
+		parts.pop_back();
+		if (!best.proven && out_of_time())
+		{
+			// No time left to search: the part is listed by its swaps, still bounded by its upper bound.
+			++num_unproven;
+			best.stopped = true;
+			best.proven = true;
+			parts.push_back(std::move(best));
+			std::ranges::push_heap(parts, by_rank);
+			continue;
+		}
+		if (!best.proven)
+		{
+			ExactSearch::Result exact = search_exact(pick_data, part_options, constraints_of(best), false, best.starters, deadline);
+			if (!exact.complete)
+			{
+				++num_unproven;
+				best.stopped = true;
+				best.upper_bound = exact.upper_bound;
+			}
+			best.starters = std::move(exact.starters);
+			best.score = total(best.starters);
+			best.proven = true;
+			parts.push_back(std::move(best));
+			std::ranges::push_heap(parts, by_rank);
+			continue;
+		}
+		result.push_back(RankedLineup{ to_roster_positions(pick_data, requirements, best.starters), best.score, !best.stopped });
+		if (result.size() == num_lineups) break;
+
+		// The parts split from an unproven line up are bounded by its search's upper bound instead of its score.
+		std::vector<Part> split;
+		std::vector<std::uint32_t> forced = best.forced;
+		for (const StartingPositionDescription& spd : best.starters)
+		{
+			if (std::ranges::find(best.forced, spd.player) != end(best.forced)) continue;
+			split.push_back(Part{ best.starters, 0.0, forced, best.excluded, best.stopped ? best.upper_bound : best.score, false });
+			split.back().excluded.push_back(spd.player);
+			forced.push_back(spd.player);
+		}
+		pool.parallel_for(split.size(), [&](std::size_t i) {search_part(split[i]); });
+		for (Part& part : split)
+		{
+			if (part.starters.empty()) continue;
+			parts.push_back(std::move(part));
+			std::ranges::push_heap(parts, by_rank);
+		}
+	}
+	Log::info("Listed {} line ups.\n", result.size());
+	if (num_unproven > 0u)
+	{
+		Log::info("{} parts could not be proven before the time limit; the line ups not proven are marked.\n", num_unproven);
+	}
+
+	std::ranges::stable_sort(result, std::greater<double>{}, &RankedLineup::score);
+	return result;
+}
+
+// Picks disjoint line ups for several teams from one roster, maximising the total of each team's score times its
+// weight. shared must have an entry for every player, scored for merge_draft_requirements(teams), so its slots are
+// each team's in turn; every team searches its own slots cut from it.
+// The teams pick in order of weight, heaviest first, each taking the best players left. Then, until nothing improves
+// the total, every team makes its best swaps with the players no team starts, and the best move of a starter between
+// two teams is made: either exchanging them for one of the other team's starters, or taking their place while the
+// other team brings in its best replacement from the bench. So a player the first team took but the second team
+// needed more ends up in the second team. Those moves can stop short of the best draft, so with options.exact the
+// exact search then runs over every team's slots at once, starting from the draft they found, within the time budget
+// and options.exact_time_limit. The draft is the proven best only if it finishes.
+std::vector<std::vector<RosterPosition>> pick_draft(PickData shared, std::span<const PositionRequirements> teams, std::span<const double> weights, const PickOptions& options)
+{
+	assert(teams.size() == weights.size());
+	std::optional<std::chrono::steady_clock::time_point> deadline;
+	if (options.time_budget.has_value())
+	{
+		deadline = std::chrono::steady_clock::now() + options.time_budget.value();
+	}
+	auto out_of_time = [&deadline]() {return deadline.has_value() && std::chrono::steady_clock::now() >= deadline.value(); };
+
+	// Each team's slots, with the players sorted by their best score for that team.
+	std::vector<PickData> team_data;
+	std::size_t first_slot = 0u;
+	for (const PositionRequirements& team : teams)
+	{
+		PickData data{ shared.names, shared.scores.slots(first_slot, team.attacking.size()), shared.players };
+		for (PickTempData& ptd : data.players) ptd.max_score = data.scores.max_score(ptd.id);
+		std::ranges::stable_sort(data.players, std::greater<double>{}, &PickTempData::max_score);
+		first_slot += team.attacking.size();
+		team_data.push_back(std::move(data));
+	}
+
+	constexpr std::size_t NO_TEAM = std::numeric_limits<std::size_t>::max();
+	std::vector<std::size_t> team_of(shared.names.size(), NO_TEAM);
+	std::vector<std::vector<StartingPositionDescription>> starters(teams.size());
+	std::vector<double> scores(teams.size());
+	auto update_teams = [&]()
+		{
+			std::ranges::fill(team_of, NO_TEAM);
+			for (std::size_t t = 0u; t < teams.size(); ++t)
+			{
+				for (const StartingPositionDescription& spd : starters[t]) team_of[spd.player] = t;
+			}
+		};
+
+	{
+		const PhaseTimer timer{ ProfilePhase::InitialSeed };
+		Log::info("Picking initial starting line ups...\n");
+		std::vector<std::size_t> pick_order(teams.size());
+		std::iota(begin(pick_order), end(pick_order), std::size_t{ 0 });
+		std::ranges::stable_sort(pick_order, std::greater<double>{}, [&weights](std::size_t t) {return weights[t]; });
+		for (std::size_t t : pick_order)
+		{
+			std::vector<PickTempData> lineup;
+			for (auto it = begin(team_data[t].players); it != end(team_data[t].players) && lineup.size() < teams[t].attacking.size(); ++it)
+			{
+				if (team_of[it->id] == NO_TEAM) lineup.push_back(*it);
+			}
+			std::tie(starters[t], scores[t]) = arrange_starters(lineup, team_data[t].scores, teams[t], options);
+			update_teams();
+		}
+	}
+
+	// A starter of team `from` moved into team `to` in place of one of its starters.
+	struct DraftMove
+	{
+		std::size_t to = 0u, from = 0u;
+		std::vector<StartingPositionDescription> to_starters, from_starters;
+		double gain = 0.0;
+	};
+	auto weighted_total = [&]() {return std::transform_reduce(begin(scores), end(scores), begin(weights), 0.0); };
+	ThreadPool pool{ options.threads };
+	bool has_made_change = true;
+	int round = 0;
+	while (has_made_change && !out_of_time())
+	{
+		has_made_change = false;
+		for (std::size_t t = 0u; t < teams.size(); ++t)
+		{
+			LineupConstraints constraints{ {}, std::vector<char>(shared.names.size(), false) };
+			for (std::size_t id = 0u; id < team_of.size(); ++id) constraints.excluded[id] = team_of[id] != NO_TEAM && team_of[id] != t;
+			scores[t] = swap_until_no_gain(team_data[t], teams[t], options, constraints, false, starters[t], scores[t], deadline);
+			update_teams();
+		}
+		Log::info("{}: total {:.0f} after swaps with the bench.\n", round++, weighted_total());
+		if (out_of_time()) break;
+
+		const PhaseTimer timer{ ProfilePhase::SwapSearch };
+		std::vector<LineupAssignment> current;
+		for (std::size_t t = 0u; t < teams.size(); ++t) current.push_back(make_lineup_assignment(starters[t], team_data[t].scores));
+
+		// For each team and starter, that team's best line up with the starter replaced from the bench. Bench players
+		// are tried in order of their dual bound (see swap_gain_bound), stopping once the bound cannot beat the best.
+		std::vector<std::vector<std::optional<std::pair<std::vector<StartingPositionDescription>, double>>>> refills(teams.size());
+		for (std::size_t u = 0u; u < teams.size(); ++u)
+		{
+			const ScoreMatrix& matrix = team_data[u].scores;
+			std::vector<std::pair<double, PickTempData>> bench;
+			for (const PickTempData& player : team_data[u].players)
+			{
+				if (team_of[player.id] != NO_TEAM) continue;
+				bench.emplace_back(dual_margin(current[u].offence, matrix.row(Unit::Offence, player.id)) + dual_margin(current[u].defence, matrix.row(Unit::Defence, player.id)), player);
+			}
+			std::ranges::stable_sort(bench, std::greater<double>{}, [](const auto& candidate) {return candidate.first; });
+			const double tolerance = 1e-9 * (1.0 + std::abs(scores[u]));
+			refills[u].resize(starters[u].size());
+			pool.parallel_for(starters[u].size(), [&](std::size_t i)
+				{
+					LineupAssignment scratch = current[u];
+					const double row_dual = current[u].offence.row_dual(i) + current[u].defence.row_dual(i);
+					std::uint64_t num_tried = 0u;
+					for (const auto& [margin, player] : bench)
+					{
+						if (refills[u][i].has_value() && scores[u] + margin - row_dual < refills[u][i]->second - tolerance) break;
+						++num_tried;
+						auto refill = replace_starter(starters[u], current[u], scratch, matrix, teams[u], options, i, player);
+						if (!refills[u][i].has_value() || refill.second > refills[u][i]->second) refills[u][i] = std::move(refill);
+					}
+					Profile::count(ProfileCounter::SwapsTried, num_tried);
+				});
+		}
+
+		// One candidate per starter moving out, so ties go to the earliest team and row whatever the threads.
+		std::vector<std::pair<std::size_t, std::size_t>> movers;
+		for (std::size_t u = 0u; u < teams.size(); ++u)
+		{
+			for (std::size_t p = 0u; p < starters[u].size(); ++p) movers.emplace_back(u, p);
+		}
+		std::vector<std::optional<DraftMove>> moves(movers.size());
+		pool.parallel_for(movers.size(), [&](std::size_t m)
+			{
+				const auto [from, p] = movers[m];
+				const PickTempData mover{ starters[from][p].player };
+				std::vector<LineupAssignment> scratch = current;
+				std::uint64_t num_tried = 0u;
+				for (std::size_t to = 0u; to < teams.size(); ++to)
+				{
+					if (to == from) continue;
+					for (std::size_t x = 0u; x < starters[to].size(); ++x)
+					{
+						auto [to_starters, to_score] = replace_starter(starters[to], current[to], scratch[to], team_data[to].scores, teams[to], options, x, mover);
+						auto from_lineup = replace_starter(starters[from], current[from], scratch[from], team_data[from].scores, teams[from], options, p, PickTempData{ starters[to][x].player });
+						if (refills[from][p].has_value() && refills[from][p]->second > from_lineup.second) from_lineup = refills[from][p].value();
+						num_tried += 2u;
+						const double gain = weights[to] * (to_score - scores[to]) + weights[from] * (from_lineup.second - scores[from]);
+						if (!moves[m].has_value() || gain > moves[m]->gain)
+						{
+							moves[m] = DraftMove{ to, from, std::move(to_starters), std::move(from_lineup.first), gain };
+						}
+					}
+				}
+				Profile::count(ProfileCounter::SwapsTried, num_tried);
+			});
+
+		const double tolerance = 1e-9 * (1.0 + std::abs(weighted_total()));
+		std::optional<std::size_t> best_move;
+		for (std::size_t m = 0u; m < moves.size(); ++m)
+		{
+			if (moves[m].has_value() && moves[m]->gain > (best_move.has_value() ? moves[best_move.value()]->gain : tolerance)) best_move = m;
+		}
+		if (best_move.has_value())
+		{
+			DraftMove& move = moves[best_move.value()].value();
+			const std::uint32_t moved = starters[move.from][movers[best_move.value()].second].player;
+			Log::info("    Moved {} from team {} to team {}\n", shared.names[moved], move.from + 1u, move.to + 1u);
+			for (std::size_t t : { move.to, move.from })
+			{
+				starters[t] = std::move(t == move.to ? move.to_starters : move.from_starters);
+				scores[t] = std::transform_reduce(begin(starters[t]), end(starters[t]), 0.0, std::plus<double>{},
+					[](const StartingPositionDescription& spd) {return spd.score; });
+			}
+			update_teams();
+			has_made_change = true;
+			Profile::count(ProfileCounter::SwapsAccepted);
+		}
+	}
+
+	// The moves can stop at a draft that no one move improves but that is not the best, so with --exact the teams
+	// are then searched jointly, starting from it: the exact search over every team's slots at once, each scored by
+	// its team's weight, with each player chosen given a team.
+	if (options.exact && !out_of_time())
+	{
+		std::optional<std::chrono::steady_clock::time_point> exact_deadline = deadline;
+		if (options.exact_time_limit.has_value())
+		{
+			const auto limit = std::chrono::steady_clock::now() + options.exact_time_limit.value();
+			exact_deadline = deadline.has_value() ? std::min(deadline.value(), limit) : limit;
+		}
+
+		std::vector<std::size_t> team_sizes;
+		for (const PositionRequirements& team : teams) team_sizes.push_back(team.attacking.size());
+		const ScoreMatrix& matrix = shared.scores;
+
+		std::vector<PickTempData> players;
+		players.reserve(shared.players.size());
+		for (const PickTempData& ptd : shared.players)
+		{
+			double max_score = std::numeric_limits<double>::lowest();
+			for (std::size_t t = 0u; t < teams.size(); ++t) max_score = std::max(max_score, weights[t] * team_data[t].scores.max_score(ptd.id));
+			players.push_back(PickTempData{ ptd.id, max_score });
+		}
+		std::ranges::stable_sort(players, std::greater<double>{}, &PickTempData::max_score);
+		const std::size_t num_pruned = prune_dominated_players(players, matrix);
+		Log::info("Pruned {} of {} players who are outscored at every position by at least {} others.\n", num_pruned, shared.players.size(), matrix.lineup_size);
+
+		std::vector<StartingPositionDescription> incumbent;
+		for (std::size_t t = 0u, first = 0u; t < teams.size(); first += team_sizes[t++])
+		{
+			for (StartingPositionDescription spd : starters[t])
+			{
+				spd.offence = PositionDescription{ static_cast<std::uint32_t>(first + spd.offence.slot), weights[t] * spd.offence.score };
+				spd.defence = PositionDescription{ static_cast<std::uint32_t>(first + spd.defence.slot), weights[t] * spd.defence.score };
+				spd.score = spd.offence.score + spd.defence.score;
+				incumbent.push_back(spd);
+			}
+		}
+
+		Log::info("Searching all teams together...\n");
+		ExactSearch search{ players, matrix, team_sizes, weights };
+		const ExactSearch::Result exact = search.run(incumbent, exact_deadline);
+		if (exact.complete)
+		{
+			Log::info("    Proven best after {} nodes.\n", exact.nodes);
+		}
+		else
+		{
+			const double gap = exact.upper_bound - exact.score;
+			Log::info("    Stopped after {} nodes. Best {:.2f}, upper bound {:.2f}, gap {:.2f} ({:.2f}%).\n",
+				exact.nodes, exact.score, exact.upper_bound, gap, exact.score != 0.0 ? 100.0 * gap / std::abs(exact.score) : 0.0);
+		}
+
+		// Back to each team's own slots and unweighted scores.
+		std::vector<std::size_t> first_slot_of(teams.size());
+		std::exclusive_scan(begin(team_sizes), end(team_sizes), begin(first_slot_of), std::size_t{ 0 });
+		for (std::vector<StartingPositionDescription>& team_starters : starters) team_starters.clear();
+		for (StartingPositionDescription spd : exact.starters)
+		{
+			const std::size_t t = static_cast<std::size_t>(std::ranges::upper_bound(first_slot_of, spd.offence.slot) - begin(first_slot_of)) - 1u;
+			const std::uint32_t offence_slot = spd.offence.slot - static_cast<std::uint32_t>(first_slot_of[t]);
+			const std::uint32_t defence_slot = spd.defence.slot - static_cast<std::uint32_t>(first_slot_of[t]);
+			const ScoreMatrix& team_matrix = team_data[t].scores;
+			spd.offence = PositionDescription{ offence_slot, team_matrix.score(Unit::Offence, spd.player, offence_slot) };
+			spd.defence = PositionDescription{ defence_slot, team_matrix.score(Unit::Defence, spd.player, defence_slot) };
+			spd.score = spd.offence.score + spd.defence.score;
+			starters[t].push_back(spd);
+		}
+	}
+
+	std::vector<std::vector<RosterPosition>> result;
+	for (std::size_t t = 0u; t < teams.size(); ++t) result.push_back(to_roster_positions(team_data[t], teams[t], starters[t]));
+	return result;
+}
+
+// How close a player is to the line up. For a starter, how much better the line up is than the best with them swapped
+// out; for anyone else, how much their score at each position would have to rise for swapping them in to pay. Only
+// single swaps are tried, so both are upper bounds: re-picking more of the line up can only make them smaller.
+struct PlayerSensitivity
+{
+	std::uint32_t player = 0u; // ID
+	bool starting = false;
+	// Starters only. The margin is infinite when there is no one to replace them.
+	double margin = 0.0;
+	std::uint32_t replacement = 0u; // ID
+	// Everyone else, by position ID.
+	std::vector<double> increases;
+};
+
+// The sensitivity of every player in pick_data to the starters: the starters in order, then the rest, the smallest
+// rise needed first. This comes from the duals of the starters' arrangements rather than from solving again.
+// totals_without gives each side's best with any one starter and slot taken out, so a player's best line up in
+// place of each starter, playing each slot, is the sum of two lookups: O(lineup_size²) a player, the cost of a few
+// swaps. A rise at a position only counts where the player plays it, on one side or on both, so the rise needed is
+// the smallest shortfall against the current line up over the starters they could replace, halved when they would
+// play the position on both sides. As in the swap search, only swaps for one starter are considered: a rise that
+// would pay only with other changes to the line up too is not found.
+std::vector<PlayerSensitivity> find_sensitivities(const PickData& pick_data, const PositionRequirements& requirements,
+	const std::vector<StartingPositionDescription>& starters, std::size_t threads)
+{
+	const PhaseTimer timer{ ProfilePhase::Sensitivity };
+	const ScoreMatrix& matrix = pick_data.scores;
+	const std::size_t lineup_size = starters.size();
+	const std::size_t num_positions = matrix.num_positions;
+	const LineupAssignment current = make_lineup_assignment(starters, matrix);
+	const double total = current.offence.total() + current.defence.total();
+	const double tolerance = 1e-9 * (1.0 + std::abs(total));
+	const std::vector<double> offence_without = current.offence.totals_without();
+	const std::vector<double> defence_without = current.defence.totals_without();
+
+	std::vector<char> starting(pick_data.names.size(), false);
+	for (const StartingPositionDescription& spd : starters) starting[spd.player] = true;
+	std::vector<std::uint32_t> bench;
+	for (const PickTempData& ptd : pick_data.players)
+	{
+		if (!starting[ptd.id]) bench.push_back(ptd.id);
+	}
+
+	// The best line up with each starter swapped out, and who replaces them. Ties go to the player earliest in
+	// pick_data, so the result does not depend on the number of threads.
+	constexpr double LOWEST = std::numeric_limits<double>::lowest();
+	std::vector<std::pair<double, std::size_t>> best_without(lineup_size, std::pair{ LOWEST, bench.size() });
+	std::vector<PlayerSensitivity> others(bench.size());
+	std::mutex best_mutex;
+	parallel_rows(bench.size(), PARALLEL_SCORE_ROWS, threads, [&](std::size_t first, std::size_t last)
+		{
+			std::vector<std::pair<double, std::size_t>> local_best(lineup_size, std::pair{ LOWEST, bench.size() });
+			std::vector<double> offence_at(num_positions), defence_at(num_positions);
+			for (std::size_t b = first; b < last; ++b)
+			{
+				const std::span<const double> offence_scores = matrix.row(Unit::Offence, bench[b]);
+				const std::span<const double> defence_scores = matrix.row(Unit::Defence, bench[b]);
+				PlayerSensitivity& result = others[b];
+				result.player = bench[b];
+				result.increases.assign(num_positions, std::numeric_limits<double>::infinity());
+				for (std::size_t row = 0u; row < lineup_size; ++row)
+				{
+					// The player's best on each side in place of this starter, anywhere and at each position.
+					std::ranges::fill(offence_at, LOWEST);
+					std::ranges::fill(defence_at, LOWEST);
+					for (std::size_t slot = 0u; slot < lineup_size; ++slot)
+					{
+						double& offence = offence_at[requirements.attacking_ids[slot]];
+						offence = std::max(offence, offence_scores[slot] + offence_without[row * lineup_size + slot]);
+						double& defence = defence_at[requirements.defensive_ids[slot]];
+						defence = std::max(defence, defence_scores[slot] + defence_without[row * lineup_size + slot]);
+					}
+					const double offence_any = std::ranges::max(offence_at);
+					const double defence_any = std::ranges::max(defence_at);
+					if (offence_any + defence_any > local_best[row].first) local_best[row] = std::pair{ offence_any + defence_any, b };
+					if (total - (offence_any + defence_any) <= tolerance)
+					{
+						// Already as good as the line up, with no rise at all.
+						std::ranges::fill(result.increases, 0.0);
+						continue;
+					}
+
+					for (std::size_t pos = 0u; pos < num_positions; ++pos)
+					{
+						double& increase = result.increases[pos];
+						if (offence_at[pos] != LOWEST) increase = std::min(increase, total - (offence_at[pos] + defence_any));
+						if (defence_at[pos] != LOWEST) increase = std::min(increase, total - (offence_any + defence_at[pos]));
+						if (offence_at[pos] != LOWEST && defence_at[pos] != LOWEST)
+						{
+							increase = std::min(increase, (total - (offence_at[pos] + defence_at[pos])) / 2.0);
+						}
+					}
+				}
+				for (double& increase : result.increases) increase = increase > tolerance ? increase : 0.0;
+			}
+
+			std::scoped_lock lock{ best_mutex };
+			for (std::size_t row = 0u; row < lineup_size; ++row)
+			{
+				if (local_best[row].first > best_without[row].first || (local_best[row].first == best_without[row].first && local_best[row].second < best_without[row].second))
+				{
+					best_without[row] = local_best[row];
+				}
+			}
+		});
+
+	std::vector<PlayerSensitivity> result;
+	result.reserve(pick_data.players.size());
+	for (std::size_t row = 0u; row < lineup_size; ++row)
+	{
+		PlayerSensitivity starter{ starters[row].player, true, std::numeric_limits<double>::infinity(), 0u, {} };
+		if (best_without[row].second < bench.size())
+		{
+			const double margin = total - best_without[row].first;
+			starter.margin = margin > tolerance ? margin : 0.0;
+			starter.replacement = bench[best_without[row].second];
+		}
+		result.push_back(std::move(starter));
+	}
+	std::ranges::stable_sort(others, {}, [](const PlayerSensitivity& ps) {return std::ranges::min(ps.increases); });
+	std::ranges::move(others, std::back_inserter(result));
+	return result;
+}
+
+// scores must come from score_positions, or the cache, for this roster and requirements.
+std::vector<RosterPosition> pick_team(const Roster& roster, const PositionRequirements& requirements, const PositionScores& scores, const PickOptions& options)
+{
+	return pick_team(to_pick_data(roster, requirements, scores, options.threads), requirements, options);
+}
+
+std::vector<RosterPosition> pick_team(const Roster& roster, const PositionRequirements& requirements, const PickOptions& options)
+{
+	return pick_team(roster, requirements, score_positions(roster, requirements, options.threads), options);
+}
+
+// Puts picks in the order they are shown: by offensive position as listed in the composition, best first within each.
+std::vector<RosterPosition> order_picks(std::vector<RosterPosition> picks, const PositionRequirements& requirements)
+{
+	std::ranges::sort(picks, std::greater<double>{}, [](const RosterPosition& rp) {return rp.total_score; });
+
+	std::vector<RosterPosition> output;
+	output.reserve(picks.size());
+
+	for (std::string_view pos : requirements.attacking)
+	{
+		auto pick_it = std::ranges::find(picks, pos, [](const RosterPosition& rp) {return rp.offence; });
+		assert(pick_it != end(picks));
+		output.push_back(std::move(*pick_it));
+		picks.erase(pick_it);
+	}
+	return output;
+}
+
+std::string json_escape(std::string_view text)
+{
+	std::string result;
+	result.reserve(text.size());
+	for (char c : text)
+	{
+		switch (c)
+		{
+		case '"': result += "\\\""; break;
+		case '\\': result += "\\\\"; break;
+		case '\n': result += "\\n"; break;
+		case '\r': result += "\\r"; break;
+		case '\t': result += "\\t"; break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20u) result += std::format("\\u{:04x}", static_cast<unsigned int>(c));
+			else result += c;
+			break;
+		}
+	}
+	return result;
+}
+
+// The scores and players of a picked team as JSON object members, players in the order given.
+std::string picks_json(const std::vector<RosterPosition>& picks)
+{
+	double offence = 0.0, defence = 0.0;
+	std::string players;
+	for (const RosterPosition& pick : picks)
+	{
+		offence += pick.offensive_score;
+		defence += pick.defensive_score;
+		players += std::format("{}{{\"name\":\"{}\",\"offence\":\"{}\",\"defence\":\"{}\",\"offensive_score\":{},\"defensive_score\":{}}}",
+			players.empty() ? "" : ",", json_escape(pick.name), json_escape(pick.offence), json_escape(pick.defence),
+			pick.offensive_score, pick.defensive_score);
+	}
+	return std::format("\"offence\":{},\"defence\":{},\"total\":{},\"players\":[{}]", offence, defence, offence + defence, players);
+}
+
+std::string errors_json(const std::vector<std::string>& errors)
+{
+	std::string error_list;
+	for (const std::string& error : errors)
+	{
+		error_list += std::format("{}\"{}\"", error_list.empty() ? "" : ",", json_escape(error));
+	}
+	return std::format("\"errors\":[{}]", error_list);
+}
+
+struct BatchJob
+{
+	std::size_t line_number = 0u;
+	std::filesystem::path team_data, composition;
+};
+
+// Each line of a manifest is a team data path and a composition path, separated by whitespace. Blank lines and
+// lines starting with '#' are skipped.
+std::vector<BatchJob> read_batch_manifest(std::string_view text, std::vector<std::string>& errors)
+{
+	std::vector<BatchJob> result;
+	LineScanner lines{ text };
+	while (std::optional<std::string_view> line = lines.next())
+	{
+		if (line->starts_with('#')) continue;
+		BatchJob job;
+		job.line_number = lines.line_number();
+		job.team_data = next_token(line.value());
+		job.composition = next_token(line.value());
+		if (job.composition.empty() || !next_token(line.value()).empty())
+		{
+			errors.push_back(std::format("Line {}: expected a team data path and a composition path", job.line_number));
+			continue;
+		}
+		result.push_back(std::move(job));
+	}
+	return result;
+}
+
+// Runs every job, writing one line of JSON per job to out in manifest order. Each roster is loaded and each
+// composition compiled once, however many jobs use it. Jobs are spread over options.threads threads and each job
+// is picked on a single thread.
+void run_batch(const std::vector<BatchJob>& jobs, PickOptions options, std::ostream& out)
+{
+	ThreadPool pool{ options.threads };
+	options.threads = 1u;
+
+	auto index_of = []<typename T>(std::vector<T>& items, const T& item)
+		{
+			auto it = std::ranges::find(items, item);
+			if (it == end(items)) it = items.insert(it, item);
+			return static_cast<std::size_t>(it - begin(items));
+		};
+
+	std::vector<std::filesystem::path> roster_paths;
+	std::vector<std::size_t> job_rosters;
+	for (const BatchJob& job : jobs) job_rosters.push_back(index_of(roster_paths, job.team_data));
+	std::vector<std::optional<Roster>> rosters(roster_paths.size());
+	pool.parallel_for(rosters.size(), [&](std::size_t i) {rosters[i] = load_roster(roster_paths[i]); });
+
+	// A composition compiles differently against rosters with different stats, so it is keyed by both.
+	using CompositionKey = std::pair<std::filesystem::path, const std::vector<std::string>*>;
+	std::vector<CompositionKey> composition_keys;
+	std::vector<std::size_t> job_compositions(jobs.size(), std::numeric_limits<std::size_t>::max());
+	for (std::size_t i = 0u; i < jobs.size(); ++i)
+	{
+		const std::optional<Roster>& roster = rosters[job_rosters[i]];
+		if (!roster.has_value() || !roster->errors.empty()) continue;
+		auto it = std::ranges::find_if(composition_keys, [&](const CompositionKey& key)
+			{
+				return key.first == jobs[i].composition && *key.second == roster->stat_names;
+			});
+		if (it == end(composition_keys)) it = composition_keys.insert(it, CompositionKey{ jobs[i].composition, &roster->stat_names });
+		job_compositions[i] = static_cast<std::size_t>(it - begin(composition_keys));
+	}
+	std::vector<std::optional<PositionRequirements>> compositions(composition_keys.size());
+	pool.parallel_for(compositions.size(), [&](std::size_t i)
+		{
+			std::ifstream input{ composition_keys[i].first };
+			if (input.is_open()) compositions[i] = parse_position_requirements(input, *composition_keys[i].second);
+		});
+
+	std::mutex output_mutex;
+	std::vector<std::optional<std::string>> lines(jobs.size());
+	std::size_t next_line = 0u;
+	pool.parallel_for(jobs.size(), [&](std::size_t i)
+		{
+			const BatchJob& job = jobs[i];
+			std::string line = std::format("{{\"line\":{},\"team_data\":\"{}\",\"composition\":\"{}\"",
+				job.line_number, json_escape(job.team_data.string()), json_escape(job.composition.string()));
+			std::vector<std::string> errors;
+			const std::optional<Roster>& roster = rosters[job_rosters[i]];
+			const PositionRequirements* requirements = nullptr;
+			if (!roster.has_value())
+			{
+				errors.push_back(std::format("Could not open {}", job.team_data.string()));
+			}
+			else if (!roster->errors.empty())
+			{
+				errors = roster->errors;
+			}
+			else if (!compositions[job_compositions[i]].has_value())
+			{
+				errors.push_back(std::format("Could not open {}", job.composition.string()));
+			}
+			else
+			{
+				requirements = &compositions[job_compositions[i]].value();
+				errors = requirements->errors;
+			}
+
+			const std::string result = errors.empty()
+				? picks_json(order_picks(pick_team(roster.value(), *requirements, options), *requirements))
+				: errors_json(errors);
+			line += std::format(",{}}}\n", result);
+
+			// Lines are written as soon as every earlier job has finished.
+			std::scoped_lock lock{ output_mutex };
+			lines[i] = std::move(line);
+			for (; next_line < lines.size() && lines[next_line].has_value(); ++next_line)
+			{
+				out << lines[next_line].value() << std::flush;
+				lines[next_line].reset();
+			}
+		});
+}
+
+struct DraftTeam
+{
+	std::size_t line_number = 0u;
+	std::filesystem::path composition;
+	double weight = 1.0;
+};
+
+// Each line of a draft file is a composition path, optionally followed by the team's weight (1 if not given), for
+// one team, first team first. Blank lines and lines starting with '#' are skipped.
+std::vector<DraftTeam> read_draft_file(std::string_view text, std::vector<std::string>& errors)
+{
+	std::vector<DraftTeam> result;
+	LineScanner lines{ text };
+	while (std::optional<std::string_view> line = lines.next())
+	{
+		if (line->starts_with('#')) continue;
+		DraftTeam team;
+		team.line_number = lines.line_number();
+		team.composition = next_token(line.value());
+		const std::string_view weight = next_token(line.value());
+		if (!weight.empty())
+		{
+			const std::from_chars_result parse_result = std::from_chars(weight.data(), weight.data() + weight.size(), team.weight);
+			if (parse_result.ec != std::errc{} || parse_result.ptr != weight.data() + weight.size() || !(team.weight > 0.0) || !std::isfinite(team.weight) || !next_token(line.value()).empty())
+			{
+				errors.push_back(std::format("Line {}: expected a composition path and an optional weight above 0", team.line_number));
+				continue;
+			}
+		}
+		result.push_back(std::move(team));
+	}
+	if (result.empty() && errors.empty())
+	{
+		errors.push_back("No teams listed");
+	}
+	if (result.size() > ExactSearch::MAX_TEAMS)
+	{
+		errors.push_back(std::format("{} teams listed, but a draft can have at most {}", result.size(), ExactSearch::MAX_TEAMS));
+	}
+	return result;
+}
+
+// Answers --serve requests, one line each, keeping rosters, compositions and their scores between requests. A
+// player's scores are recomputed when their stats are updated; everything else is reused.
+class PickServer
+{
+public:
+	explicit PickServer(const PickOptions& options) : m_options{ options } {}
+
+	// Returns the response to one request line (empty for a blank line), or an empty optional if the client asked
+	// to quit.
+	std::optional<std::string> handle(std::string_view request)
+	{
+		std::scoped_lock lock{ m_mutex };
+		request = trim_whitespace(request);
+		const std::string_view command = next_token(request);
+		if (command.empty()) return std::string{};
+		if (cicmp(command, "quit")) return std::nullopt;
+
+		std::vector<std::string> errors;
+		std::string response;
+		if (cicmp(command, "load-roster")) response = load_roster_request(request, errors);
+		else if (cicmp(command, "load-composition")) response = load_composition_request(request, errors);
+		else if (cicmp(command, "update")) response = update_request(request, errors);
+		else if (cicmp(command, "pick")) response = pick_request(request, false, errors);
+		else if (cicmp(command, "repick")) response = pick_request(request, true, errors);
+		else errors.push_back(std::format("Unknown request '{}'", command));
+		return std::format("{{{}}}", errors.empty() ? response : errors_json(errors));
+	}
+
+private:
+	struct LoadedRoster
+	{
+		Roster roster;
+		std::map<std::string_view, std::size_t> rows;
+	};
+
+	struct ScoredTeam
+	{
+		PositionRequirements requirements;
+		PickData pick_data;
+		std::vector<RosterPosition> last_picks;
+	};
+
+	// load-roster <roster id> <path>
+	std::string load_roster_request(std::string_view args, std::vector<std::string>& errors)
+	{
+		const std::string_view id = next_token(args);
+		const std::filesystem::path path{ trim_whitespace(args) };
+		if (path.empty())
+		{
+			errors.push_back("Expected: load-roster <roster id> <path>");
+			return {};
+		}
+		std::optional<Roster> roster = load_roster(path, m_options.threads);
+		if (!roster.has_value())
+		{
+			errors.push_back(std::format("Could not open {}", path.string()));
+			return {};
+		}
+		if (!roster->errors.empty())
+		{
+			errors = roster->errors;
+			return {};
+		}
+
+		LoadedRoster loaded{ std::move(roster.value()), {} };
+		for (std::size_t row = 0u; row < loaded.roster.size(); ++row)
+		{
+			loaded.rows.emplace(loaded.roster.names[row], row);
+		}
+		const std::size_t num_players = loaded.roster.size();
+		m_rosters.insert_or_assign(std::string{ id }, std::move(loaded));
+		std::erase_if(m_teams, [id](const auto& team) {return team.first.first == id; });
+		return std::format("\"ok\":true,\"players\":{}", num_players);
+	}
+
+	// load-composition <composition id> <path>
+	std::string load_composition_request(std::string_view args, std::vector<std::string>& errors)
+	{
+		const std::string_view id = next_token(args);
+		const std::filesystem::path path{ trim_whitespace(args) };
+		if (path.empty())
+		{
+			errors.push_back("Expected: load-composition <composition id> <path>");
+			return {};
+		}
+		std::ifstream input{ path };
+		if (!input.is_open())
+		{
+			errors.push_back(std::format("Could not open {}", path.string()));
+			return {};
+		}
+		m_compositions.insert_or_assign(std::string{ id }, std::string{ std::istreambuf_iterator<char>{ input }, std::istreambuf_iterator<char>{} });
+		std::erase_if(m_teams, [id](const auto& team) {return team.first.second == id; });
+		return "\"ok\":true";
+	}
+
+	// update <roster id> <stat> <value> <player name>
+	std::string update_request(std::string_view args, std::vector<std::string>& errors)
+	{
+		const std::string_view id = next_token(args);
+		const std::string_view stat = next_token(args);
+		const std::optional<int> value = parse_int(next_token(args));
+		const std::string_view name = trim_whitespace(args);
+		if (!value.has_value() || name.empty())
+		{
+			errors.push_back("Expected: update <roster id> <stat> <value> <player name>");
+			return {};
+		}
+		auto roster_it = m_rosters.find(id);
+		if (roster_it == end(m_rosters))
+		{
+			errors.push_back(std::format("No roster '{}'", id));
+			return {};
+		}
+		LoadedRoster& loaded = roster_it->second;
+		auto stat_it = std::ranges::find_if(loaded.roster.stat_names, [stat](const std::string& s) {return cicmp(s, stat); });
+		auto row_it = loaded.rows.find(name);
+		if (stat_it == end(loaded.roster.stat_names)) errors.push_back(std::format("Unknown stat '{}'", stat));
+		if (row_it == end(loaded.rows)) errors.push_back(std::format("No player '{}'", name));
+		if (!errors.empty()) return {};
+
+		const std::size_t row = row_it->second;
+		loaded.roster.columns[stat_it - begin(loaded.roster.stat_names)][row] = value.value();
+		for (auto& [key, team] : m_teams)
+		{
+			if (key.first == id) rescore_player(team.pick_data, loaded.roster, row, team.requirements);
+		}
+		return "\"ok\":true";
+	}
+
+	// pick <roster id> <composition id>, or repick to start from the last line up picked for them.
+	std::string pick_request(std::string_view args, bool warm_start, std::vector<std::string>& errors)
+	{
+		const std::string roster_id{ next_token(args) };
+		const std::string composition_id{ next_token(args) };
+		auto roster_it = m_rosters.find(roster_id);
+		auto composition_it = m_compositions.find(composition_id);
+		if (roster_it == end(m_rosters)) errors.push_back(std::format("No roster '{}'", roster_id));
+		if (composition_it == end(m_compositions)) errors.push_back(std::format("No composition '{}'", composition_id));
+		if (!errors.empty()) return {};
+
+		const std::pair key{ roster_id, composition_id };
+		auto team_it = m_teams.find(key);
+		if (team_it == end(m_teams))
+		{
+			const Roster& roster = roster_it->second.roster;
+			std::istringstream input{ composition_it->second };
+			ScoredTeam team{ parse_position_requirements(input, roster.stat_names), {}, {} };
+			if (!team.requirements.errors.empty())
+			{
+				errors = team.requirements.errors;
+				return {};
+			}
+			team.pick_data = to_pick_data(roster, team.requirements, m_options.threads);
+			team_it = m_teams.emplace(key, std::move(team)).first;
+		}
+		ScoredTeam& team = team_it->second;
+		team.last_picks = warm_start && !team.last_picks.empty()
+			? repick_team(team.pick_data, team.requirements, team.last_picks, m_options)
+			: pick_team(team.pick_data, team.requirements, m_options);
+		return picks_json(order_picks(team.last_picks, team.requirements));
+	}
+
+	PickOptions m_options;
+	std::mutex m_mutex;
+	std::map<std::string, LoadedRoster, std::less<>> m_rosters;
+	std::map<std::string, std::string, std::less<>> m_compositions;
+	std::map<std::pair<std::string, std::string>, ScoredTeam> m_teams;
+};
+
+// Answers requests from stdin on stdout until the input ends or a quit request.
+void serve_stdio(PickServer& server, std::ostream& out)
+{
+	std::string request;
+	while (std::getline(std::cin, request))
+	{
+		const std::optional<std::string> response = server.handle(request);
+		if (!response.has_value()) break;
+		if (!response->empty()) out << response.value() << '\n' << std::flush;
+	}
+}
+
+#if !defined(_WIN32)
+// Listens on a Unix domain socket, answering each connection on its own thread. Returns false if the socket
+// cannot be set up; otherwise runs until the process is stopped.
+bool serve_socket(PickServer& server, const std::filesystem::path& path, std::ostream& out)
+{
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	const std::string path_text = path.string();
+	if (path_text.size() >= sizeof(address.sun_path)) return false;
+	std::ranges::copy(path_text, address.sun_path);
+
+	const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0) return false;
+	::unlink(path_text.c_str());
+	if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, SOMAXCONN) != 0)
+	{
+		::close(listener);
+		return false;
+	}
+	std::signal(SIGPIPE, SIG_IGN);
+	out << "Listening on " << path << std::endl;
+
+	while (true)
+	{
+		const int connection = accept(listener, nullptr, nullptr);
+		if (connection < 0) continue;
+		std::thread{ [&server, connection]()
+			{
+				std::string pending;
+				std::array<char, 4096> buffer;
+				bool open = true;
+				while (open)
+				{
+					const ssize_t count = recv(connection, buffer.data(), buffer.size(), 0);
+					if (count <= 0) break;
+					pending.append(buffer.data(), static_cast<std::size_t>(count));
+					for (std::size_t end = pending.find('\n'); open && end != std::string::npos; end = pending.find('\n'))
+					{
+						std::optional<std::string> response = server.handle(std::string_view{ pending }.substr(0u, end));
+						pending.erase(0u, end + 1u);
+						open = response.has_value();
+						if (!open || response->empty()) continue;
+						response->push_back('\n');
+						open = send(connection, response->data(), response->size(), 0) == static_cast<ssize_t>(response->size());
+					}
+				}
+				::close(connection);
+			} }.detach();
+	}
+}
+#endif
+
+// Settings for the --benchmark generator, given as comma-separated key=value pairs.
+struct GeneratorConfig
+{
+	enum class Distribution
+	{
+		Uniform,
+		Normal
+	};
+
+	std::size_t players = 1000u;
+	std::size_t stats = 8u;
+	std::size_t lineup = 11u;
+	std::size_t positions = 6u;
+	std::size_t complexity = 2u;
+	std::uint64_t seed = 1u;
+	Distribution distribution = Distribution::Uniform;
+};
+
+std::optional<GeneratorConfig> parse_generator_config(std::string_view spec, std::string& error)
+{
+	GeneratorConfig result;
+	while (!spec.empty())
+	{
+		const std::size_t comma = std::min(spec.find(','), spec.size());
+		const std::string_view item = trim_whitespace(spec.substr(0u, comma));
+		spec.remove_prefix(std::min(comma + 1u, spec.size()));
+		if (item.empty()) continue;
+
+		const std::size_t equals = item.find('=');
+		const std::string_view key = trim_whitespace(item.substr(0u, equals));
+		const std::string_view value = equals == std::string_view::npos ? std::string_view{} : trim_whitespace(item.substr(equals + 1u));
+		if (cicmp(key, "distribution"))
+		{
+			if (cicmp(value, "uniform")) result.distribution = GeneratorConfig::Distribution::Uniform;
+			else if (cicmp(value, "normal")) result.distribution = GeneratorConfig::Distribution::Normal;
+			else
+			{
+				error = std::format("Unknown distribution '{}'", value);
+				return std::nullopt;
+			}
+			continue;
+		}
+
+		std::uint64_t number = 0u;
+		const std::from_chars_result parse_result = std::from_chars(value.data(), value.data() + value.size(), number);
+		if (value.empty() || parse_result.ec != std::errc{} || parse_result.ptr != value.data() + value.size())
+		{
+			error = std::format("'{}' needs a number", key);
+			return std::nullopt;
+		}
+		if (cicmp(key, "seed")) result.seed = number;
+		else if (cicmp(key, "players")) result.players = static_cast<std::size_t>(number);
+		else if (cicmp(key, "stats")) result.stats = static_cast<std::size_t>(number);
+		else if (cicmp(key, "lineup")) result.lineup = static_cast<std::size_t>(number);
+		else if (cicmp(key, "positions")) result.positions = static_cast<std::size_t>(number);
+		else if (cicmp(key, "complexity")) result.complexity = static_cast<std::size_t>(number);
+		else
+		{
+			error = std::format("Unknown setting '{}'", key);
+			return std::nullopt;
+		}
+	}
+	if (result.stats == 0u || result.positions == 0u || result.lineup == 0u || result.players < result.lineup)
+	{
+		error = "Need at least one stat and position, and at least as many players as the line up";
+		return std::nullopt;
+	}
+	return result;
+}
+
+// Generates rosters and compositions from a seed. Only the engine's raw output is used, never the standard
+// distributions, so the same seed gives the same files with any standard library.
+class RosterGenerator
+{
+public:
+	explicit RosterGenerator(const GeneratorConfig& config) : m_config{ config }, m_random{ config.seed } {}
+
+	std::string roster()
+	{
+		std::string result = "Name";
+		for (std::size_t stat = 0u; stat < m_config.stats; ++stat) result += std::format(" S{}", stat);
+		result += '\n';
+		for (std::size_t player = 0u; player < m_config.players; ++player)
+		{
+			result += std::format("Player {}\nGenerated", player);
+			for (std::size_t stat = 0u; stat < m_config.stats; ++stat) result += std::format(" {}", stat_value());
+			result += '\n';
+		}
+		return result;
+	}
+
+	// Each side draws lineup positions from a shared pool, so positions repeat and some are on both sides.
+	std::string composition()
+	{
+		std::string result;
+		for (std::string_view side : { "Offence:", "Defence:" })
+		{
+			result += side;
+			for (std::size_t slot = 0u; slot < m_config.lineup; ++slot) result += std::format(" P{}", uniform(m_config.positions));
+			result += '\n';
+		}
+		for (std::size_t pos = 0u; pos < m_config.positions; ++pos)
+		{
+			result += std::format("P{}={}\n", pos, expression(m_config.complexity));
+		}
+		return result;
+	}
+
+private:
+	GeneratorConfig m_config;
+	std::mt19937_64 m_random;
+
+	std::size_t uniform(std::size_t count) { return static_cast<std::size_t>(m_random() % count); }
+	double unit() { return static_cast<double>(m_random() >> 11) * 0x1.0p-53; }
+
+	int stat_value()
+	{
+		if (m_config.distribution == GeneratorConfig::Distribution::Uniform) return 10 + static_cast<int>(uniform(90u));
+		// Box-Muller, clamped to the range the uniform distribution uses.
+		const double normal = std::sqrt(-2.0 * std::log(1.0 - unit())) * std::cos(2.0 * 3.14159265358979323846 * unit());
+		return std::clamp(static_cast<int>(std::lround(55.0 + 15.0 * normal)), 10, 99);
+	}
+
+	// A random calculation nested depth deep. Division is only by constants so no score is infinite.
+	std::string expression(std::size_t depth)
+	{
+		const std::string stat = std::format("S{}", uniform(m_config.stats));
+		if (depth == 0u) return uniform(5u) == 0u ? std::format("{}", 1 + uniform(9u)) : stat;
+		switch (uniform(7u))
+		{
+		case 0u: return std::format("({} + {})", expression(depth - 1u), expression(depth - 1u));
+		case 1u: return std::format("({} - {} / 2)", expression(depth - 1u), expression(depth - 1u));
+		case 2u: return std::format("{} * 0.{}", expression(depth - 1u), 1 + uniform(9u));
+		case 3u: return std::format("max({}, {})", expression(depth - 1u), expression(depth - 1u));
+		case 4u: return std::format("min({}, {}, {})", expression(depth - 1u), expression(depth - 1u), stat);
+		case 5u: return std::format("average({}, {})", expression(depth - 1u), expression(depth - 1u));
+		default: return std::format("if({} > {}, {}, {})", stat, 10 + uniform(90u), expression(depth - 1u), expression(depth - 1u));
+		}
+	}
+};
+
+struct BenchmarkResult
+{
+	std::string name;
+	std::size_t iterations = 0u;
+	double mean_ns = 0.0;
+	double min_ns = 0.0;
+};
+
+// Runs fn at least three times and until about a quarter of a second has passed.
+template <typename Fn>
+BenchmarkResult run_benchmark(std::string name, Fn&& fn)
+{
+	using clock = std::chrono::steady_clock;
+	constexpr auto min_duration = std::chrono::milliseconds{ 250 };
+	BenchmarkResult result{ std::move(name), 0u, 0.0, std::numeric_limits<double>::max() };
+	double total_ns = 0.0;
+	const auto start = clock::now();
+	while (result.iterations < 3u || clock::now() - start < min_duration)
+	{
+		const auto before = clock::now();
+		fn();
+		const double ns = std::chrono::duration<double, std::nano>(clock::now() - before).count();
+		total_ns += ns;
+		result.min_ns = std::min(result.min_ns, ns);
+		++result.iterations;
+	}
+	result.mean_ns = total_ns / static_cast<double>(result.iterations);
+	return result;
+}
+
+struct BenchmarkCheck
+{
+	std::string name;
+	std::string status; // "passed", "failed" or "skipped"
+	std::string detail;
+};
+
+double team_total(const std::vector<RosterPosition>& picks)
+{
+	return std::transform_reduce(begin(picks), end(picks), 0.0, std::plus<double>{}, [](const RosterPosition& rp) {return rp.total_score; });
+}
+
+// Times each stage of a pick on a generated roster and composition, then checks that the different ways of
+// solving agree. Writes one JSON object to out. Returns false if a check failed.
+bool run_benchmarks(const GeneratorConfig& config, const PickOptions& options, std::ostream& out)
+{
+	RosterGenerator generator{ config };
+	const std::string roster_text = generator.roster();
+	const std::string composition_text = generator.composition();
+
+	const Roster roster = parse_roster(MappedFile::from_string(roster_text));
+	std::istringstream composition_input{ composition_text };
+	const PositionRequirements requirements = parse_position_requirements(composition_input, roster.stat_names);
+	assert(roster.errors.empty());
+	if (!requirements.errors.empty())
+	{
+		out << std::format("{{{}}}\n", errors_json(requirements.errors));
+		return false;
+	}
+
+	PickData sorted_data = to_pick_data(roster, requirements);
+	std::ranges::stable_sort(sorted_data.players, std::greater<double>{}, [](const PickTempData& ptd) {return ptd.max_score; });
+	const std::span<const PickTempData> sorted_players = sorted_data.players;
+	const ScoreMatrix& matrix = sorted_data.scores;
+	const auto [starters, starters_score] = get_initial_try_starters(sorted_players, matrix, requirements, options);
+	const LineupAssignment current = make_lineup_assignment(starters, matrix);
+
+	volatile double sink = 0.0;
+	std::vector<BenchmarkResult> results;
+	results.push_back(run_benchmark("parse_roster", [&]() {sink = static_cast<double>(parse_roster(MappedFile::from_string(roster_text)).size()); }));
+	results.push_back(run_benchmark("parse_roster_threaded", [&]()
+		{
+			sink = static_cast<double>(parse_roster(MappedFile::from_string(roster_text), options.threads).size());
+		}));
+	results.push_back(run_benchmark("parse_composition", [&]()
+		{
+			std::istringstream input{ composition_text };
+			sink = static_cast<double>(parse_position_requirements(input, roster.stat_names).position_to_formula.size());
+		}));
+	results.push_back(run_benchmark("evaluate_formulas_batch", [&]() {sink = score_positions(roster, requirements).front().back(); }));
+	results.push_back(run_benchmark("evaluate_formulas_scalar", [&]()
+		{
+			double total = 0.0;
+			for (const auto& [pos, formula] : requirements.position_to_formula)
+			{
+				for (std::size_t row = 0u; row < roster.size(); ++row) total += evaluate_formula(formula, roster, row);
+			}
+			sink = total;
+		}));
+	results.push_back(run_benchmark("to_pick_data", [&]() {sink = to_pick_data(roster, requirements).players.back().max_score; }));
+	results.push_back(run_benchmark("to_pick_data_threaded", [&]() {sink = to_pick_data(roster, requirements, options.threads).players.back().max_score; }));
+	const std::span<const PickTempData> lineup = sorted_players.first(config.lineup);
+	results.push_back(run_benchmark("find_best_positions_hungarian", [&]()
+		{
+			sink = find_best_positions(lineup, matrix, requirements, Unit::Offence, AssignmentMethod::Hungarian).second;
+		}));
+	if (config.lineup <= 8u)
+	{
+		results.push_back(run_benchmark("find_best_positions_exhaustive", [&]()
+			{
+				sink = find_best_positions(lineup, matrix, requirements, Unit::Offence, AssignmentMethod::Exhaustive).second;
+			}));
+	}
+	results.push_back(run_benchmark("try_swapping_in_player", [&]()
+		{
+			LineupAssignment scratch = current;
+			double total = 0.0;
+			for (const PickTempData& player : sorted_players.subspan(config.lineup).first(std::min<std::size_t>(100u, sorted_players.size() - config.lineup)))
+			{
+				const std::optional<SwapResult> swap = try_swapping_in_player(starters, current, scratch, matrix, requirements, options, LineupConstraints{}, player);
+				total += swap.has_value() ? swap->delta : 0.0;
+			}
+			sink = total;
+		}));
+	results.push_back(run_benchmark("pick_team", [&]() {sink = team_total(pick_team(roster, requirements, options)); }));
+	results.push_back(run_benchmark("pick_top_10_lineups", [&]()
+		{
+			sink = pick_top_lineups(to_pick_data(roster, requirements, options.threads), requirements, options, 10u).back().score;
+		}));
+	const PickData sensitivity_data = to_pick_data(roster, requirements);
+	PickData searched_data = sensitivity_data;
+	const std::vector<StartingPositionDescription> sensitivity_starters = pick_starters(searched_data, requirements, options);
+	results.push_back(run_benchmark("find_sensitivities", [&]()
+		{
+			sink = find_sensitivities(sensitivity_data, requirements, sensitivity_starters, options.threads).back().margin;
+		}));
+	if (roster.size() >= 3u * config.lineup)
+	{
+		const std::vector<PositionRequirements> teams(3u, requirements);
+		const std::vector<double> weights{ 1.0, 0.5, 0.25 };
+		const PositionRequirements draft = merge_draft_requirements(teams);
+		results.push_back(run_benchmark("pick_draft_3_teams", [&]()
+			{
+				sink = team_total(pick_draft(to_pick_data(roster, draft, options.threads), teams, weights, options).back());
+			}));
+	}
+
+	std::vector<BenchmarkCheck> checks;
+	auto check = [&checks](std::string name, bool passed, std::string detail)
+		{
+			checks.push_back(BenchmarkCheck{ std::move(name), passed ? "passed" : "failed", std::move(detail) });
+		};
+	auto close = [](double a, double b) {return std::abs(a - b) <= 1e-6 * (1.0 + std::abs(a)); };
+
+	{
+		const PositionScores batch = score_positions(roster, requirements);
+		std::size_t mismatches = 0u;
+		for (auto column = begin(batch); const auto& [pos, formula] : requirements.position_to_formula)
+		{
+			for (std::size_t row = 0u; row < roster.size(); ++row)
+			{
+				if (!close((*column)[row], evaluate_formula(formula, roster, row))) ++mismatches;
+			}
+			++column;
+		}
+		check("batch_matches_scalar_scores", mismatches == 0u, std::format("{} mismatched scores", mismatches));
+	}
+
+	{
+		const Roster threaded = parse_roster(MappedFile::from_string(roster_text), options.threads);
+		const PickData serial_data = to_pick_data(roster, requirements);
+		const PickData threaded_data = to_pick_data(threaded, requirements, options.threads);
+		const bool same_roster = threaded.names == roster.names && threaded.columns == roster.columns && threaded.errors == roster.errors;
+		const bool same_scores = threaded_data.scores.positions == serial_data.scores.positions
+			&& threaded_data.scores.offence == serial_data.scores.offence
+			&& threaded_data.scores.defence == serial_data.scores.defence
+			&& std::ranges::equal(threaded_data.players, serial_data.players, [](const PickTempData& a, const PickTempData& b)
+				{
+					return a.id == b.id && a.max_score == b.max_score;
+				});
+		check("threaded_load_matches_serial", same_roster && same_scores,
+			same_roster ? (same_scores ? "identical" : "scores differ") : "rosters differ");
+	}
+
+	const std::vector<RosterPosition> hungarian_picks = pick_team(roster, requirements, options);
+	const double hungarian_total = team_total(hungarian_picks);
+	if (config.lineup <= 8u)
+	{
+		std::size_t mismatches = 0u;
+		for (std::size_t first = 0u; first + config.lineup <= sorted_players.size() && first < 50u; ++first)
+		{
+			const std::span<const PickTempData> players = sorted_players.subspan(first, config.lineup);
+			for (Unit unit : { Unit::Offence, Unit::Defence })
+			{
+				const double hungarian = find_best_positions(players, matrix, requirements, unit, AssignmentMethod::Hungarian).second;
+				const double exhaustive = find_best_positions(players, matrix, requirements, unit, AssignmentMethod::Exhaustive).second;
+				if (!close(hungarian, exhaustive)) ++mismatches;
+			}
+		}
+		check("assignment_hungarian_matches_exhaustive", mismatches == 0u, std::format("{} mismatched arrangements", mismatches));
+
+		PickOptions exhaustive_options = options;
+		exhaustive_options.assignment = AssignmentMethod::Exhaustive;
+		const double exhaustive_total = team_total(pick_team(roster, requirements, exhaustive_options));
+		check("pick_hungarian_matches_exhaustive", close(hungarian_total, exhaustive_total), std::format("{} and {}", hungarian_total, exhaustive_total));
+	}
+	else
+	{
+		checks.push_back(BenchmarkCheck{ "assignment_hungarian_matches_exhaustive", "skipped", "line up too large to arrange exhaustively" });
+		checks.push_back(BenchmarkCheck{ "pick_hungarian_matches_exhaustive", "skipped", "line up too large to arrange exhaustively" });
+	}
+
+	// Swapping a player in re-arranges the other starters too, so each swap's gain from the incremental solve must
+	// match arranging the new line up from scratch, for the initial line up and the players just off it.
+	{
+		const AssignmentMethod method = config.lineup <= 8u ? AssignmentMethod::Exhaustive : AssignmentMethod::Hungarian;
+		PickOptions resolve_options = options;
+		resolve_options.assignment = method;
+		const double tolerance = 1e-9 * (1.0 + std::abs(starters_score));
+		LineupAssignment scratch = current;
+		std::size_t mismatches = 0u;
+		for (const PickTempData& player : sorted_players.subspan(config.lineup, std::min<std::size_t>(50u, sorted_players.size() - config.lineup)))
+		{
+			const std::optional<SwapResult> swap = try_swapping_in_player(starters, current, scratch, matrix, requirements, options, LineupConstraints{}, player);
+			double best_gain = tolerance;
+			for (std::size_t row = 0u; row < config.lineup; ++row)
+			{
+				std::vector<PickTempData> trial{ begin(sorted_players), begin(sorted_players) + config.lineup };
+				trial[row] = player;
+				best_gain = std::max(best_gain, arrange_starters(trial, matrix, requirements, resolve_options).second - starters_score);
+			}
+			const bool found = swap.has_value();
+			if (found != (best_gain > tolerance) || (found && !close(swap->delta, best_gain))) ++mismatches;
+		}
+		check("swaps_match_resolving", mismatches == 0u, std::format("{} mismatched swaps ({})", mismatches,
+			method == AssignmentMethod::Exhaustive ? "every arrangement tried" : "Hungarian method from scratch"));
+	}
+
+	{
+		PickOptions single_thread = options;
+		single_thread.threads = 1u;
+		const std::vector<RosterPosition> single_picks = pick_team(roster, requirements, single_thread);
+		const bool same = std::ranges::equal(single_picks, hungarian_picks, [](const RosterPosition& a, const RosterPosition& b)
+			{
+				return a.name == b.name && a.offence == b.offence && a.defence == b.defence;
+			});
+		check("pick_same_on_one_thread", same, std::format("{} and {}", team_total(single_picks), hungarian_total));
+	}
+
+	{
+		const double repicked_total = team_total(repick_team(to_pick_data(roster, requirements), requirements, hungarian_picks, options));
+		check("repick_keeps_unchanged_team", close(hungarian_total, repicked_total), std::format("{} and {}", hungarian_total, repicked_total));
+	}
+
+	// The exact search on the whole roster and on the streamed one must find the same optimum.
+	{
+		auto exact_score = [&requirements, &options](PickData data) -> std::optional<double>
+			{
+				std::ranges::stable_sort(data.players, std::greater<double>{}, [](const PickTempData& ptd) {return ptd.max_score; });
+				prune_dominated_players(data.players, data.scores);
+				const auto [exact_starters, exact_starters_score] = get_initial_try_starters(data.players, data.scores, requirements, options);
+				ExactSearch search{ data.players, data.scores };
+				const ExactSearch::Result result = search.run(exact_starters, std::chrono::steady_clock::now() + std::chrono::seconds{ 5 });
+				return result.complete ? std::optional{ result.score } : std::nullopt;
+			};
+		RosterStream stream{ Roster{}, LineScanner{ std::string_view{} } };
+		stream.batch.source = MappedFile::from_string(roster_text);
+		stream.lines = LineScanner{ stream.batch.source->contents() };
+		read_header(stream.lines, stream.batch);
+		const Roster streamed = stream_top_players(stream, requirements);
+
+		const std::optional<double> full_exact = exact_score(to_pick_data(roster, requirements));
+		const std::optional<double> streamed_exact = exact_score(to_pick_data(streamed, requirements));
+		if (full_exact.has_value() && streamed_exact.has_value())
+		{
+			check("exact_same_when_streamed", close(full_exact.value(), streamed_exact.value()), std::format("{} and {}", full_exact.value(), streamed_exact.value()));
+			check("exact_not_worse_than_pick", full_exact.value() >= hungarian_total - 1e-6 * (1.0 + std::abs(hungarian_total)),
+				std::format("{} and {}", full_exact.value(), hungarian_total));
+		}
+		else
+		{
+			checks.push_back(BenchmarkCheck{ "exact_same_when_streamed", "skipped", "exact search did not finish in 5 s" });
+			checks.push_back(BenchmarkCheck{ "exact_not_worse_than_pick", "skipped", "exact search did not finish in 5 s" });
+		}
+	}
+
+	// Each starter's margin must be what the best swap for them loses, and a rise just over what one of the closest
+	// other players needs at a position must make swapping them in worthwhile, while one just under must not.
+	{
+		const std::vector<PlayerSensitivity> sensitivities = find_sensitivities(sensitivity_data, requirements, sensitivity_starters, options.threads);
+		const LineupAssignment current = make_lineup_assignment(sensitivity_starters, sensitivity_data.scores);
+		const double total = current.offence.total() + current.defence.total();
+		PickData raised = sensitivity_data;
+		LineupAssignment scratch = current;
+		auto best_swap = [&](std::uint32_t player, std::size_t first_row, std::size_t last_row)
+			{
+				double best = std::numeric_limits<double>::lowest();
+				for (std::size_t row = first_row; row < last_row; ++row)
+				{
+					best = std::max(best, replace_starter(sensitivity_starters, current, scratch, raised.scores, requirements, options, row, PickTempData{ player }).second);
+				}
+				return best;
+			};
+
+		std::size_t mismatches = 0u;
+		for (std::size_t row = 0u; row < sensitivity_starters.size(); ++row)
+		{
+			double best = std::numeric_limits<double>::lowest();
+			for (const PlayerSensitivity& ps : sensitivities)
+			{
+				if (!ps.starting) best = std::max(best, best_swap(ps.player, row, row + 1u));
+			}
+			if (!close(sensitivities[row].margin, std::max(total - best, 0.0))) ++mismatches;
+		}
+
+		constexpr double EPSILON = 1e-3;
+		const std::size_t num_others = std::min<std::size_t>(10u, sensitivities.size() - sensitivity_starters.size());
+		for (const PlayerSensitivity& ps : std::span{ sensitivities }.subspan(sensitivity_starters.size(), num_others))
+		{
+			const std::span<const double> original = sensitivity_data.scores.position_row(ps.player);
+			std::vector<double> position_scores(begin(original), end(original));
+			for (std::size_t pos = 0u; pos < ps.increases.size(); ++pos)
+			{
+				auto best_with_rise = [&](double rise)
+					{
+						position_scores[pos] = original[pos] + rise;
+						raised.scores.set_player(ps.player, position_scores, requirements);
+						const double best = best_swap(ps.player, 0u, sensitivity_starters.size());
+						position_scores[pos] = original[pos];
+						raised.scores.set_player(ps.player, position_scores, requirements);
+						return best;
+					};
+				// Enough makes the swap at least as good: a player who ties with the line up needs no rise.
+				const bool enough = best_with_rise(ps.increases[pos] + EPSILON) >= total - 1e-9 * (1.0 + std::abs(total));
+				const bool too_little = ps.increases[pos] < EPSILON || best_with_rise(ps.increases[pos] - EPSILON) < total;
+				if (!enough || !too_little) ++mismatches;
+			}
+		}
+		check("sensitivity_matches_swaps", mismatches == 0u, std::format("{} mismatched margins and rises", mismatches));
+	}
+
+	// The compiled-in scorer must give exactly the scores of its own composition's calculations. It is run on the
+	// generated roster's stats, reused in turn for as many stats as the scorer has.
+#if defined(TEAM_PICKER_SCORER)
+	{
+		std::string scorer_composition = "Offence:";
+		for (std::string_view pos : generated_scorer::OFFENCE) scorer_composition += std::format(" {}", pos);
+		scorer_composition += "\nDefence:";
+		for (std::string_view pos : generated_scorer::DEFENCE) scorer_composition += std::format(" {}", pos);
+		scorer_composition += '\n';
+		for (std::size_t p = 0u; p < generated_scorer::POSITIONS.size(); ++p)
+		{
+			scorer_composition += std::format("{}={}\n", generated_scorer::POSITIONS[p], generated_scorer::CALCULATIONS[p]);
+		}
+		Roster scorer_roster;
+		scorer_roster.source = roster.source;
+		scorer_roster.names = roster.names;
+		for (std::size_t stat = 0u; stat < generated_scorer::STAT_NAMES.size(); ++stat)
+		{
+			scorer_roster.stat_names.emplace_back(generated_scorer::STAT_NAMES[stat]);
+			scorer_roster.columns.push_back(roster.columns[stat % roster.columns.size()]);
+		}
+		std::istringstream scorer_input{ scorer_composition };
+		const PositionRequirements scorer_requirements = parse_position_requirements(scorer_input, scorer_roster.stat_names);
+		if (!scorer_requirements.errors.empty() || scorer_requirements.hash != generated_scorer::COMPOSITION_HASH
+			|| !std::ranges::equal(scorer_requirements.attacking_ids, generated_scorer::OFFENCE_IDS)
+			|| !std::ranges::equal(scorer_requirements.defensive_ids, generated_scorer::DEFENCE_IDS))
+		{
+			check("generated_scorer_matches_graph", false, "the scorer's calculations do not compile to the composition it was generated from");
+		}
+		else
+		{
+			const PositionScores generated = score_positions_generated(scorer_roster, options.threads);
+			const PositionScores evaluated = evaluate_all_rows(scorer_requirements.graph, scorer_roster, scorer_requirements.position_nodes, options.threads);
+			std::size_t mismatches = 0u;
+			for (std::size_t p = 0u; p < generated.size(); ++p)
+			{
+				for (std::size_t row = 0u; row < scorer_roster.size(); ++row)
+				{
+					const double a = generated[p][row];
+					const double b = evaluated[p][row];
+					if (a != b && !(std::isnan(a) && std::isnan(b))) ++mismatches;
+				}
+			}
+			check("generated_scorer_matches_graph", mismatches == 0u, std::format("{} mismatched scores", mismatches));
+		}
+	}
+#else
+	checks.push_back(BenchmarkCheck{ "generated_scorer_matches_graph", "skipped", "built without TEAM_PICKER_SCORER" });
+#endif
+
+	const bool passed = std::ranges::none_of(checks, [](const BenchmarkCheck& c) {return c.status == "failed"; });
+	out << std::format("{{\"config\":{{\"players\":{},\"stats\":{},\"lineup\":{},\"positions\":{},\"complexity\":{},\"seed\":{},\"distribution\":\"{}\"}},\n",
+		config.players, config.stats, config.lineup, config.positions, config.complexity, config.seed,
+		config.distribution == GeneratorConfig::Distribution::Uniform ? "uniform" : "normal");
+	out << "\"benchmarks\":[\n";
+	for (std::size_t i = 0u; i < results.size(); ++i)
+	{
+		const BenchmarkResult& r = results[i];
+		out << std::format("{{\"name\":\"{}\",\"iterations\":{},\"mean_ns\":{:.0f},\"min_ns\":{:.0f}}}{}\n",
+			r.name, r.iterations, r.mean_ns, r.min_ns, i + 1u < results.size() ? "," : "");
+	}
+	out << "],\n\"checks\":[\n";
+	for (std::size_t i = 0u; i < checks.size(); ++i)
+	{
+		const BenchmarkCheck& c = checks[i];
+		out << std::format("{{\"name\":\"{}\",\"status\":\"{}\",\"detail\":\"{}\"}}{}\n",
+			c.name, c.status, json_escape(c.detail), i + 1u < checks.size() ? "," : "");
+	}
+	out << std::format("],\n\"passed\":{}}}\n", passed);
+	return passed;
+}
+
+int main(int argc, char** argv)
+{
+	std::atexit(Log::flush);
+	auto quit = []()
+		{
+			Log::flush();
+			std::cout << "Press 'Enter' to quit.";
+			std::cin.get();
+			exit(0);
+		};
+
+	// The log level is needed before the args are read. Serving and batch runs write machine-readable output, so they
+	// skip the usual progress messages.
+	const std::span<char*> args{ argv + 1, argv + argc };
+	auto has_arg = [args](std::string_view name)
+		{
+			return std::ranges::any_of(args, [name](std::string_view arg) {return cicmp(arg, name); });
+		};
+	const bool machine_output = has_arg("--serve") || has_arg("--socket") || has_arg("--batch") || has_arg("--benchmark");
+	if (machine_output || has_arg("--quiet"))
+	{
+		Log::set_level(LogLevel::Error);
+	}
+	else if (has_arg("--verbose"))
+	{
+		Log::set_level(LogLevel::Trace);
+	}
+	Log::info("Reading command line args\n");
+	std::filesystem::path team_data{ "team_data.txt" };
+	std::filesystem::path composition{ "composition.txt" };
+	std::filesystem::path cache_path;
+	std::filesystem::path batch_manifest;
+	std::filesystem::path socket_path;
+	std::filesystem::path scorer_path;
+	std::filesystem::path draft_path;
+	PickOptions options;
+	bool stream_roster = false;
+	bool cache_trust_time = false;
+	bool serve = false;
+	bool sensitivity = false;
+	std::size_t top_k = 1u;
+	std::optional<GeneratorConfig> benchmark;
+	{
+		enum class ArgState
+		{
+			NotFound,
+			Next,
+			Found
+		};
+		ArgState td_state = ArgState::NotFound;
+		ArgState cmp_state = ArgState::NotFound;
+		ArgState cache_state = ArgState::NotFound;
+		ArgState batch_state = ArgState::NotFound;
+		ArgState socket_state = ArgState::NotFound;
+		ArgState scorer_state = ArgState::NotFound;
+		ArgState draft_state = ArgState::NotFound;
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string_view arg{ argv[i] };
+			if (cicmp(arg, "--help") || cicmp(arg, "-help") || cicmp(arg, "help"))
+			{
+				Log::flush();
+				std::cout << "Team Picker by arkadye.\n"
+					"Usage: arguments optional.\n"
+					"    --team-data [path]: a path to a team data file\n"
+					"    --composition [path]: a path to a composition file\n"
+					"    --cache [path]: keep the parsed team data and position scores in this file to speed up later runs\n"
+					"    --cache-trust-time: with --cache, skip hashing the team data if its size and modification time are unchanged\n"
+					"    --batch [path]: pick a team for every team data and composition pair listed in this file, writing one line of JSON for each\n"
+					"    --serve: answer requests to load rosters, update stats and pick teams, one per line, on stdin and stdout\n"
+					"    --socket [path]: as --serve, but listen on a Unix domain socket at the path\n"
+					"    --generate-scorer [path]: write a C++ header that scores the composition, to build in with -DTEAM_PICKER_SCORER\n"
+					"    --benchmark [settings]: time each stage on a generated roster and check the solvers agree, e.g. players=1000,lineup=11,seed=2\n"
+					"    --stream: read the team data a batch at a time, keeping only players who could make the best line up\n"
+					"    --exhaustive: find positions by trying every arrangement instead of the Hungarian method\n"
+					"    --threads [N]: number of threads to read, score and try swaps on (default 0: one per core)\n"
+					"    --time-budget [duration]: keep improving the team by simulated annealing until the duration (e.g. 500ms) is up\n"
+					"    --exact: after the normal pick, search for the proven best line up\n"
+					"    --exact-time-limit [duration]: as --exact, but stop after the duration (e.g. 2s, 500ms) and report the gap\n"
+					"    --top-k [N]: list the N best line ups with different starters, best first, each proven by the exact search\n"
+					"    --draft [path]: pick a team for every composition listed in this file, with no player in two teams (with --exact, searched for the proven best draft)\n"
+					"    --sensitivity: after the team, show how much each starter keeps their place by and how much everyone else must improve to start, as upper bounds from single swaps\n"
+					"    --profile: time each phase and count the work done, printing a JSON report to stderr at exit\n"
+					"    --quiet: print only errors and the team picked\n"
+					"    --verbose: also print a line for every player read and scored\n"
+					"    --async-log: write progress messages from a background thread\n"
+					"For more info and latest versions visit https://github.com/arkadye/team_picker\n";
+				quit();
+			}
+			auto handle_arg = [arg, &quit](std::filesystem::path& target, ArgState& state, std::string_view match)
+				{
+					if (state == ArgState::Next)
+					{
+						target = arg;
+						state = ArgState::Found;
+						return true;
+					}
+
+					if (cicmp(arg, match))
+					{
+						if (state == ArgState::Found)
+						{
+							Log::error("Multiple {} arguments found!\n", match);
+							quit();
+						}
+						state = ArgState::Next;
+						return true;
+					}
+					return false;
+				};
+
+			if (handle_arg(team_data, td_state, "--team-data")) continue;
+			if (handle_arg(composition, cmp_state, "--composition")) continue;
+			if (handle_arg(cache_path, cache_state, "--cache")) continue;
+			if (handle_arg(batch_manifest, batch_state, "--batch")) continue;
+			if (handle_arg(socket_path, socket_state, "--socket")) continue;
+			if (handle_arg(scorer_path, scorer_state, "--generate-scorer")) continue;
+			if (handle_arg(draft_path, draft_state, "--draft")) continue;
+			if (cicmp(arg, "--benchmark"))
+			{
+				// The generator settings are optional.
+				const bool has_spec = i + 1 < argc && !std::string_view{ argv[i + 1] }.starts_with("--");
+				std::string error;
+				benchmark = parse_generator_config(has_spec ? argv[++i] : "", error);
+				if (!benchmark.has_value())
+				{
+					Log::error("--benchmark: {}\n", error);
+					quit();
+				}
+				continue;
+			}
+			if (cicmp(arg, "--serve"))
+			{
+				serve = true;
+				continue;
+			}
+			if (cicmp(arg, "--stream"))
+			{
+				stream_roster = true;
+				continue;
+			}
+			if (cicmp(arg, "--cache-trust-time"))
+			{
+				cache_trust_time = true;
+				continue;
+			}
+			if (cicmp(arg, "--sensitivity"))
+			{
+				sensitivity = true;
+				continue;
+			}
+			if (cicmp(arg, "--profile"))
+			{
+				Profile::enable();
+				continue;
+			}
+			if (cicmp(arg, "--quiet") || cicmp(arg, "--verbose")) continue;
+			if (cicmp(arg, "--async-log"))
+			{
+				Log::start_async();
+				continue;
+			}
+			if (cicmp(arg, "--exhaustive"))
+			{
+				options.assignment = AssignmentMethod::Exhaustive;
+				continue;
+			}
+			if (cicmp(arg, "--threads"))
+			{
+				std::size_t threads = 0u;
+				const std::string_view value = (i + 1 < argc) ? std::string_view{ argv[++i] } : std::string_view{};
+				const std::from_chars_result parse_result = std::from_chars(value.data(), value.data() + value.size(), threads);
+				if (value.empty() || parse_result.ec != std::errc{} || parse_result.ptr != value.data() + value.size())
+				{
+					Log::error("--threads needs a number of threads (0 for one per core)\n");
+					quit();
+				}
+				options.threads = threads;
+				continue;
+			}
+			if (cicmp(arg, "--top-k"))
+			{
+				const std::string_view value = (i + 1 < argc) ? std::string_view{ argv[++i] } : std::string_view{};
+				const std::from_chars_result parse_result = std::from_chars(value.data(), value.data() + value.size(), top_k);
+				if (value.empty() || parse_result.ec != std::errc{} || parse_result.ptr != value.data() + value.size() || top_k == 0u)
+				{
+					Log::error("--top-k needs a number of line ups of at least 1\n");
+					quit();
+				}
+				continue;
+			}
+			if (cicmp(arg, "--exact"))
+			{
+				options.exact = true;
+				continue;
+			}
+			if (cicmp(arg, "--time-budget"))
+			{
+				options.time_budget = (i + 1 < argc) ? parse_duration(argv[++i]) : std::nullopt;
+				if (!options.time_budget.has_value())
+				{
+					Log::error("--time-budget needs a duration such as 2s or 500ms\n");
+					quit();
+				}
+				continue;
+			}
+			if (cicmp(arg, "--exact-time-limit"))
+			{
+				const std::optional<std::chrono::milliseconds> limit = (i + 1 < argc) ? parse_duration(argv[++i]) : std::nullopt;
+				if (!limit.has_value())
+				{
+					Log::error("--exact-time-limit needs a duration such as 2s or 500ms\n");
+					quit();
+				}
+				options.exact = true;
+				options.exact_time_limit = limit;
+				continue;
+			}
+			Log::error("Unknown argument {}\n", arg);
+			quit();
+		}
+	}
+	if (stream_roster && !cache_path.empty())
+	{
+		Log::error("--stream and --cache cannot be used together\n");
+		quit();
+	}
+	if (cache_trust_time && cache_path.empty())
+	{
+		Log::error("--cache-trust-time needs --cache\n");
+		quit();
+	}
+	if (top_k != 1u && (benchmark.has_value() || serve || !socket_path.empty() || !batch_manifest.empty()))
+	{
+		Log::error("--top-k can only be used when picking a single team\n");
+		quit();
+	}
+	if (!draft_path.empty() && (top_k != 1u || benchmark.has_value() || serve || !socket_path.empty() || !batch_manifest.empty() || !scorer_path.empty()))
+	{
+		Log::error("--draft cannot be used with --top-k, --batch, --serve, --socket, --benchmark or --generate-scorer\n");
+		quit();
+	}
+	if (sensitivity && (top_k != 1u || !draft_path.empty() || benchmark.has_value() || serve || !socket_path.empty() || !batch_manifest.empty() || !scorer_path.empty()))
+	{
+		Log::error("--sensitivity can only be used when picking a single team\n");
+		quit();
+	}
+
+	if (benchmark.has_value())
+	{
+		// Only the report goes to the console.
+		const bool passed = run_benchmarks(benchmark.value(), options, std::cout);
+		return passed ? 0 : 1;
+	}
+
+	if (serve || !socket_path.empty())
+	{
+		// Only responses go to the console; progress messages would break the protocol.
+		PickServer server{ options };
+		if (socket_path.empty())
+		{
+			serve_stdio(server, std::cout);
+			return 0;
+		}
+#if defined(_WIN32)
+		Log::error("--socket is not supported on Windows\n");
+#else
+		serve_socket(server, socket_path, std::cout);
+		Log::error("Could not listen on {}\n", socket_path.string());
+#endif
+		return 1;
+	}
+
+	if (!batch_manifest.empty())
+	{
+		if (stream_roster || !cache_path.empty())
+		{
+			Log::error("--batch cannot be used with --stream or --cache\n");
+			quit();
+		}
+		const std::shared_ptr<const MappedFile> manifest = MappedFile::open(batch_manifest);
+		if (manifest == nullptr)
+		{
+			Log::error("Could not open {}\n", batch_manifest.string());
+			quit();
+		}
+		std::vector<std::string> manifest_errors;
+		const std::vector<BatchJob> jobs = read_batch_manifest(manifest->contents(), manifest_errors);
+		for (const std::string& error : manifest_errors)
+		{
+			Log::error("Error in {}: {}\n", batch_manifest.string(), error);
+		}
+		if (!manifest_errors.empty()) quit();
+
+		// Only the results go to the console; progress from the jobs would be interleaved.
+		run_batch(jobs, options, std::cout);
+		return 0;
+	}
+
+	Log::info("Loading {}\n", team_data.string());
+	std::optional<RosterStream> roster_stream;
+	std::optional<Roster> loaded_roster;
+	ScoreCache score_cache;
+	if (stream_roster || !scorer_path.empty())
+	{
+		// Generating a scorer only needs the stat names from the header.
+		roster_stream = open_roster_stream(team_data);
+	}
+	else if (!cache_path.empty())
+	{
+		loaded_roster = load_roster(team_data, cache_path, cache_trust_time, score_cache, options.threads);
+	}
+	else
+	{
+		loaded_roster = load_roster(team_data, options.threads);
+	}
+	if (!roster_stream.has_value() && !loaded_roster.has_value())
+	{
+		Log::error("Could not open {}\n", team_data.string());
+		quit();
+	}
+	auto report_roster_errors = [&team_data, &quit](const std::vector<std::string>& errors)
+		{
+			if (errors.empty()) return;
+			for (const std::string& error : errors)
+			{
+				Log::error("Error in {}: {}\n", team_data.string(), error);
+			}
+			quit();
+		};
+	const Roster& header = roster_stream.has_value() ? roster_stream->batch : loaded_roster.value();
+	report_roster_errors(header.errors);
+
+	auto load_composition = [&header, &quit](const std::filesystem::path& path)
+		{
+			Log::info("Loading {}\n", path.string());
+			std::ifstream req_input{ path };
+			if (!req_input.is_open())
+			{
+				Log::error("Could not open {}\n", path.string());
+				quit();
+			}
+			PositionRequirements result = parse_position_requirements(req_input, header.stat_names);
+			if (!result.errors.empty())
+			{
+				for (const std::string& error : result.errors)
+				{
+					Log::error("Error in {}: {}\n", path.string(), error);
+				}
+				quit();
+			}
+			return result;
+		};
+
+	// A draft scores the roster once for all its teams, through their compositions merged into one.
+	std::vector<DraftTeam> draft_teams;
+	std::vector<PositionRequirements> draft_requirements;
+	PositionRequirements requirements;
+	if (draft_path.empty())
+	{
+		requirements = load_composition(composition);
+	}
+	else
+	{
+		Log::info("Loading {}\n", draft_path.string());
+		const std::shared_ptr<const MappedFile> draft_file = MappedFile::open(draft_path);
+		if (draft_file == nullptr)
+		{
+			Log::error("Could not open {}\n", draft_path.string());
+			quit();
+		}
+		std::vector<std::string> draft_errors;
+		draft_teams = read_draft_file(draft_file->contents(), draft_errors);
+		for (const std::string& error : draft_errors)
+		{
+			Log::error("Error in {}: {}\n", draft_path.string(), error);
+		}
+		if (!draft_errors.empty()) quit();
+		for (const DraftTeam& team : draft_teams) draft_requirements.push_back(load_composition(team.composition));
+		requirements = merge_draft_requirements(draft_requirements);
+	}
+
+	if (!scorer_path.empty())
+	{
+		std::ofstream scorer{ scorer_path, std::ios::binary };
+		scorer << generate_scorer(requirements, header.stat_names, composition.filename().string());
+		if (!scorer)
+		{
+			Log::error("Could not write {}\n", scorer_path.string());
+			return 1;
+		}
+		Log::info("Wrote a scorer for {} to {}\n", composition.string(), scorer_path.string());
+		return 0;
+	}
+
+	if (roster_stream.has_value())
+	{
+		Log::info("Streaming players from {}\n", team_data.string());
+		loaded_roster = stream_top_players(roster_stream.value(), requirements, top_k);
+		report_roster_errors(loaded_roster->errors);
+	}
+	const Roster& roster = loaded_roster.value();
+
+	// The scores are collected before the cache is saved, which releases the cached columns they are read from.
+	PickData pick_data = cache_path.empty()
+		? to_pick_data(roster, requirements, options.threads)
+		: to_pick_data(roster, requirements, score_positions(roster, requirements, score_cache, options.threads), options.threads);
+	if (score_cache.changed && !save_score_cache(cache_path, roster, std::move(score_cache)))
+	{
+		Log::error("Could not write {}\n", cache_path.string());
+	}
+
+	auto print_team = [](const PositionRequirements& requirements, std::vector<RosterPosition> picks)
+		{
+			const std::vector<RosterPosition> output = order_picks(std::move(picks), requirements);
+
+			const std::size_t max_name_len = std::ranges::max(output, {}, [](const RosterPosition& rp) {return rp.name.size(); }).name.size();
+			const std::size_t max_off_len = std::ranges::max(output, {}, [](const RosterPosition& rp) {return rp.offence.size(); }).offence.size();
+			const std::size_t max_def_len = std::ranges::max(output, {}, [](const RosterPosition& rp) {return rp.defence.size(); }).defence.size();
+
+			double team_offensive_score = 0;
+			double team_defensive_score = 0;
+			double team_total_score = 0;
+
+			for (const RosterPosition& pick : output)
+			{
+				std::cout << std::format("{:{}} / {:{}} - {:{}} {:.0f} + {:.0f} = {:.0f}\n",
+					pick.offence, max_off_len,
+					pick.defence, max_def_len,
+					pick.name, max_name_len,
+					pick.offensive_score,
+					pick.defensive_score,
+					pick.total_score
+				);
+
+				team_offensive_score += pick.offensive_score;
+				team_defensive_score += pick.defensive_score;
+				team_total_score += pick.total_score;
+			}
+
+			std::cout << std::format("\n     Team total: {:.0f} + {:.0f} = {:.0f}\n",
+				team_offensive_score,
+				team_defensive_score,
+				team_total_score
+			);
+		};
+
+	if (!draft_teams.empty())
+	{
+		if (roster.size() < requirements.attacking.size())
+		{
+			Log::error("The teams need {} players but {} has only {}\n", requirements.attacking.size(), team_data.string(), roster.size());
+			quit();
+		}
+		Log::info("Picking {} teams...\n", draft_teams.size());
+		std::vector<double> weights;
+		std::ranges::transform(draft_teams, std::back_inserter(weights), &DraftTeam::weight);
+		const std::vector<std::vector<RosterPosition>> teams = pick_draft(std::move(pick_data), draft_requirements, weights, options);
+		Log::flush();
+		double draft_total = 0.0;
+		for (std::size_t i = 0u; i < teams.size(); ++i)
+		{
+			std::cout << std::format("\nTEAM {} OF {} ({}):\n", i + 1u, teams.size(), draft_teams[i].composition.string());
+			print_team(draft_requirements[i], teams[i]);
+			draft_total += weights[i] * std::transform_reduce(begin(teams[i]), end(teams[i]), 0.0, std::plus<double>{}, [](const RosterPosition& rp) {return rp.total_score; });
+		}
+		std::cout << std::format("\n     Draft total: {:.0f}\n\n", draft_total);
+		quit();
+	}
+
+	if (top_k > 1u)
+	{
+		Log::info("Picking the best {} line ups...\n", top_k);
+		const std::vector<RankedLineup> lineups = pick_top_lineups(std::move(pick_data), requirements, options, top_k);
+		Log::flush();
+		for (std::size_t i = 0u; i < lineups.size(); ++i)
+		{
+			std::cout << std::format("\nLINE UP {} OF {}{}:\n", i + 1u, lineups.size(), lineups[i].proven ? "" : " (NOT PROVEN: A BETTER LINE UP MAY BE MISSING)");
+			print_team(requirements, lineups[i].picks);
+		}
+		std::cout << "\n";
+		quit();
+	}
+
+	Log::info("Picking the team...\n");
+	std::vector<RosterPosition> picks;
+	std::vector<PlayerSensitivity> sensitivities;
+	if (sensitivity)
+	{
+		// The report covers every player, including those pruned while picking.
+		PickData searched = pick_data;
+		const std::vector<StartingPositionDescription> starters = pick_starters(searched, requirements, options);
+		picks = to_roster_positions(pick_data, requirements, starters);
+		Log::info("Finding how close each player is to the line up...\n");
+		sensitivities = find_sensitivities(pick_data, requirements, starters, options.threads);
+	}
+	else
+	{
+		picks = pick_team(std::move(pick_data), requirements, options);
+	}
+
+	Log::flush();
+	std::cout << "\nTEAM PICKED:\n";
+	print_team(requirements, std::move(picks));
+	std::cout << "\n";
+
+	if (sensitivity)
+	{
+		std::size_t max_name_len = 0u;
+		for (const PlayerSensitivity& ps : sensitivities) max_name_len = std::max(max_name_len, roster.names[ps.player].size());
+		std::cout << "STARTERS, BY HOW MUCH BETTER THE TEAM IS THAN WITH THEIR BEST REPLACEMENT (AT MOST, TRYING SINGLE SWAPS ONLY):\n";
+		for (const PlayerSensitivity& ps : sensitivities)
+		{
+			if (!ps.starting) continue;
+			if (std::isinf(ps.margin)) std::cout << std::format("{:{}} no one to replace them\n", roster.names[ps.player], max_name_len);
+			else std::cout << std::format("{:{}} {:.1f} over {}\n", roster.names[ps.player], max_name_len, ps.margin, roster.names[ps.replacement]);
+		}
+
+		std::vector<std::string_view> positions;
+		for (const auto& [pos, formula] : requirements.position_to_formula) positions.push_back(pos);
+		const std::size_t column_len = std::max<std::size_t>(7u, std::ranges::max(positions, {}, &std::string_view::size).size());
+		std::cout << "\nEVERYONE ELSE, BY HOW MUCH THEIR SCORE AT EACH POSITION MUST RISE TO START (AT MOST, TRYING SINGLE SWAPS ONLY):\n";
+		std::cout << std::format("{:{}}", "", max_name_len);
+		for (std::string_view pos : positions) std::cout << std::format(" {:>{}}", pos, column_len);
+		std::cout << "\n";
+		for (const PlayerSensitivity& ps : sensitivities)
+		{
+			if (ps.starting) continue;
+			std::cout << std::format("{:{}}", roster.names[ps.player], max_name_len);
+			for (double increase : ps.increases) std::cout << std::format(" {:>{}.1f}", increase, column_len);
+			std::cout << "\n";
+		}
+		std::cout << "\n";
+	}
+
+	quit();
+}